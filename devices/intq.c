@@ -2,30 +2,33 @@
 #include <debug.h>
 #include "threads/thread.h"
 
-static int next (int pos);
-static void wait (struct intq *q, struct thread **waiter);
-static void signal (struct intq *q, struct thread **waiter);
+static void wait (struct intq *q, struct list *waiters);
+static void signal (struct intq *q, struct list *waiters);
 
 /* Initializes interrupt queue Q. */
 void
 intq_init (struct intq *q) {
-	lock_init (&q->lock);
-	q->not_full = q->not_empty = NULL;
+	list_init (&q->not_full);
+	list_init (&q->not_empty);
 	q->head = q->tail = 0;
 }
 
+/* Returns the number of bytes in Q. */
+size_t
+intq_count (const struct intq *q) {
+	return q->head - q->tail;
+}
+
 /* Returns true if Q is empty, false otherwise. */
 bool
 intq_empty (const struct intq *q) {
-	ASSERT (intr_get_level () == INTR_OFF);
-	return q->head == q->tail;
+	return intq_count (q) == 0;
 }
 
 /* Returns true if Q is full, false otherwise. */
 bool
 intq_full (const struct intq *q) {
-	ASSERT (intr_get_level () == INTR_OFF);
-	return next (q->head) == q->tail;
+	return intq_count (q) == INTQ_BUFSIZE;
 }
 
 /* Removes a byte from Q and returns it.
@@ -39,13 +42,12 @@ intq_getc (struct intq *q) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	while (intq_empty (q)) {
 		ASSERT (!intr_context ());
-		lock_acquire (&q->lock);
 		wait (q, &q->not_empty);
-		lock_release (&q->lock);
 	}
 
-	byte = q->buf[q->tail];
-	q->tail = next (q->tail);
+	byte = q->buf[q->tail & INTQ_MASK];
+	barrier ();
+	q->tail++;
 	signal (q, &q->not_full);
 	return byte;
 }
@@ -59,47 +61,84 @@ intq_putc (struct intq *q, uint8_t byte) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	while (intq_full (q)) {
 		ASSERT (!intr_context ());
-		lock_acquire (&q->lock);
 		wait (q, &q->not_full);
-		lock_release (&q->lock);
 	}
 
-	q->buf[q->head] = byte;
-	q->head = next (q->head);
+	q->buf[q->head & INTQ_MASK] = byte;
+	barrier ();
+	q->head++;
 	signal (q, &q->not_empty);
 }
 
-/* Returns the position after POS within an intq. */
-static int
-next (int pos) {
-	return (pos + 1) % INTQ_BUFSIZE;
+/* Removes up to N bytes from Q into BUFFER without sleeping.
+   Returns the number of bytes removed. */
+size_t
+intq_get (struct intq *q, uint8_t *buffer, size_t n) {
+	size_t tail = q->tail;
+	size_t cnt = q->head - tail;
+	size_t i;
+
+	if (cnt > n)
+		cnt = n;
+	for (i = 0; i < cnt; i++)
+		buffer[i] = q->buf[(tail + i) & INTQ_MASK];
+	barrier ();
+	q->tail = tail + cnt;
+
+	if (cnt > 0)
+		signal (q, &q->not_full);
+	return cnt;
 }
 
-/* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+/* Adds up to N bytes from BUFFER to the end of Q without
+   sleeping.  Returns the number of bytes added. */
+size_t
+intq_put (struct intq *q, const uint8_t *buffer, size_t n) {
+	size_t head = q->head;
+	size_t cnt = INTQ_BUFSIZE - (head - q->tail);
+	size_t i;
+
+	if (cnt > n)
+		cnt = n;
+	for (i = 0; i < cnt; i++)
+		q->buf[(head + i) & INTQ_MASK] = buffer[i];
+	barrier ();
+	q->head = head + cnt;
+
+	if (cnt > 0)
+		signal (q, &q->not_empty);
+	return cnt;
+}
+
+/* WAITERS must be Q's not_empty or not_full list.  Waits until
+   the given condition is true. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) {
+wait (struct intq *q UNUSED, struct list *waiters) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT ((waiter == &q->not_empty && intq_empty (q))
-			|| (waiter == &q->not_full && intq_full (q)));
+	ASSERT ((waiters == &q->not_empty && intq_empty (q))
+			|| (waiters == &q->not_full && intq_full (q)));
 
-	*waiter = thread_current ();
+	list_push_back (waiters, &thread_current ()->elem);
 	thread_block ();
 }
 
-/* WAITER must be the address of Q's not_empty or not_full
-   member, and the associated condition must be true.  If a
-   thread is waiting for the condition, wakes it up and resets
-   the waiting thread. */
+/* WAITERS must be Q's not_empty or not_full list, and the
+   associated condition must be true.  Wakes up every thread
+   waiting for the condition; each rechecks it before going on. */
 static void
-signal (struct intq *q UNUSED, struct thread **waiter) {
-	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT ((waiter == &q->not_empty && !intq_empty (q))
-			|| (waiter == &q->not_full && !intq_full (q)));
+signal (struct intq *q UNUSED, struct list *waiters) {
+	enum intr_level old_level;
 
-	if (*waiter != NULL) {
-		thread_unblock (*waiter);
-		*waiter = NULL;
-	}
+	/* A waiter checks the condition and queues itself with
+	   interrupts off, so if the list is empty now, nobody can be
+	   about to sleep on a condition that is already true. */
+	if (list_empty (waiters))
+		return;
+
+	old_level = intr_disable ();
+	while (!list_empty (waiters))
+		thread_unblock (list_entry (list_pop_front (waiters),
+					struct thread, elem));
+	intr_set_level (old_level);
 }
@@ -37,6 +37,12 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+
+/* Bytes the transmit FIFO accepts once THR Empty is set. */
+#define XMIT_FIFO_SIZE 16
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -86,6 +92,7 @@ serial_init_queue (void) {
 	ASSERT (mode == POLL);
 
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+	outb (FCR_REG, FCR_ENABLE);           /* Transmit up to 16 bytes at once. */
 	mode = QUEUE;
 	old_level = intr_disable ();
 	write_ier ();
@@ -122,13 +129,56 @@ serial_putc (uint8_t byte) {
 	intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port.  Like calling
+   serial_putc() for each byte, but interrupts are toggled and the
+   interrupt enable register written once per call rather than
+   once per byte, except when the transmit queue fills up. */
+void
+serial_putbuf (const uint8_t *buffer, size_t n) {
+	enum intr_level old_level = intr_disable ();
+
+	if (mode != QUEUE) {
+		if (mode == UNINIT)
+			init_poll ();
+		while (n-- > 0)
+			putc_poll (*buffer++);
+	} else {
+		for (;;) {
+			size_t cnt = intq_put (&txq, buffer, n);
+
+			buffer += cnt;
+			n -= cnt;
+			if (n == 0)
+				break;
+
+			/* The queue is full.  Start the transmitter on what we
+			   have.  With interrupts off we cannot wait for it, so
+			   send a byte by polling as serial_putc() does;
+			   otherwise intq_putc() sleeps until the interrupt
+			   handler makes room. */
+			write_ier ();
+			if (old_level == INTR_OFF)
+				putc_poll (intq_getc (&txq));
+			else {
+				intq_putc (&txq, *buffer++);
+				n--;
+			}
+		}
+		write_ier ();
+	}
+
+	intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
 serial_flush (void) {
+	uint8_t byte;
 	enum intr_level old_level = intr_disable ();
-	while (!intq_empty (&txq))
-		putc_poll (intq_getc (&txq));
+
+	while (intq_get (&txq, &byte, 1) > 0)
+		putc_poll (byte);
 	intr_set_level (old_level);
 }
 
@@ -205,10 +255,15 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
 		input_putc (inb (RBR_REG));
 
-	/* As long as we have a byte to transmit, and the hardware is
-	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-		outb (THR_REG, intq_getc (&txq));
+	/* Once the transmit FIFO is empty, refill all of it. */
+	if ((inb (LSR_REG) & LSR_THRE) != 0) {
+		uint8_t fifo[XMIT_FIFO_SIZE];
+		size_t cnt = intq_get (&txq, fifo, sizeof fifo);
+		size_t i;
+
+		for (i = 0; i < cnt; i++)
+			outb (THR_REG, fifo[i]);
+	}
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
@@ -1,7 +1,9 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include <string.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file {
@@ -11,13 +13,24 @@ struct file {
 	int ref_cnt;
 };
 
+/* Cache of struct file. */
+static struct slab_cache file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) {
+	slab_cache_init (&file_cache, "file", sizeof (struct file),
+			sizeof (void *), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) {
-	struct file *file = calloc (1, sizeof *file);
+	struct file *file = slab_alloc (&file_cache);
 	if (inode != NULL && file != NULL) {
+		memset (file, 0, sizeof *file);
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
@@ -25,7 +38,7 @@ file_open (struct inode *inode) {
 		return file;
 	} else {
 		inode_close (inode);
-		free (file);
+		slab_free (&file_cache, file);
 		return NULL;
 	}
 }
@@ -56,7 +69,7 @@ file_close (struct file *file) {
 	if (file != NULL) {
 		file_allow_write (file);
 		inode_close (file->inode);
-		free (file);
+		slab_free (&file_cache, file);
 	}
 }
 
@@ -1,42 +1,53 @@
 #ifndef DEVICES_INTQ_H
 #define DEVICES_INTQ_H
 
+#include <list.h>
+#include <stddef.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 
 /* An "interrupt queue", a circular buffer shared between
    kernel threads and external interrupt handlers.
 
-   Interrupt queue functions can be called from kernel threads or
-   from external interrupt handlers.  Except for intq_init(),
-   interrupts must be off in either case.
-
-   The interrupt queue has the structure of a "monitor".  Locks
-   and condition variables from threads/synch.h cannot be used in
-   this case, as they normally would, because they can only
-   protect kernel threads from one another, not from interrupt
-   handlers. */
-
-/* Queue buffer size, in bytes. */
-#define INTQ_BUFSIZE 64
+   The ring is single-producer, single-consumer: the producer
+   only advances HEAD and the consumer only advances TAIL, so one
+   side never has to stop the other to move data.  Callers that
+   may have more than one producer or consumer at once (several
+   threads printing, say) must still serialize them, normally by
+   turning interrupts off.  intq_getc() and intq_putc() may sleep
+   and must be called with interrupts off; the bulk intq_get()
+   and intq_put() never sleep.
+
+   Any number of threads may wait for a queue to become
+   non-empty or non-full.  Locks and condition variables from
+   threads/synch.h cannot be used for this, as they normally
+   would, because they can only protect kernel threads from one
+   another, not from interrupt handlers. */
+
+/* Queue buffer size, in bytes.  Must be a power of two. */
+#define INTQ_BUFSIZE 256
+#define INTQ_MASK (INTQ_BUFSIZE - 1)
 
 /* A circular queue of bytes. */
 struct intq {
 	/* Waiting threads. */
-	struct lock lock;           /* Only one thread may wait at once. */
-	struct thread *not_full;    /* Thread waiting for not-full condition. */
-	struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+	struct list not_full;       /* Threads waiting for not-full condition. */
+	struct list not_empty;      /* Threads waiting for not-empty condition. */
 
-	/* Queue. */
+	/* Queue.  HEAD and TAIL count bytes ever added and removed,
+	   so HEAD - TAIL is the number of bytes in the queue. */
 	uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
-	int head;                   /* New data is written here. */
-	int tail;                   /* Old data is read here. */
+	volatile size_t head;       /* Written only by the producer. */
+	volatile size_t tail;       /* Written only by the consumer. */
 };
 
 void intq_init (struct intq *);
+size_t intq_count (const struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
 uint8_t intq_getc (struct intq *);
 void intq_putc (struct intq *, uint8_t);
+size_t intq_get (struct intq *, uint8_t *, size_t);
+size_t intq_put (struct intq *, const uint8_t *, size_t);
 
 #endif /* devices/intq.h */
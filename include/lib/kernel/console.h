@@ -2,6 +2,7 @@
 #define __LIB_KERNEL_CONSOLE_H
 
 void console_init (void);
+void console_disable_vga (void);
 void console_panic (void);
 void console_print_stats (void);
 
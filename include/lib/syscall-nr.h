@@ -36,6 +36,10 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Stride scheduling. */
+	SYS_SET_TICKETS,            /* Set the process's CPU share. */
+	SYS_SET_TIME_SLICE,         /* Set the process's time slice. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,16 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+struct intr_frame;
+
+void fpu_init (void);
+void fpu_switch (struct thread *next);
+void fpu_handle_nm (struct intr_frame *);
+bool fpu_copy (struct thread *dst, struct thread *src);
+void fpu_release (struct thread *);
+void fpu_print_stats (void);
+
+#endif /* threads/fpu.h */
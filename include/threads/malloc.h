@@ -2,12 +2,21 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/* Empty arenas kept per size class. */
+extern size_t malloc_arena_reserve;
+
+/* Remember who allocated each live block, for leak reports. */
+extern bool malloc_track_callers;
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+size_t malloc_usable_size (void *);
+void malloc_print_stats (void);
 
 #endif /* threads/malloc.h */
@@ -0,0 +1,38 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Initializes an object each time slab_alloc() hands it out.
+   Unlike a constructor, it is not run once per object: freed
+   objects are overwritten, so it runs on every allocation. */
+typedef void slab_init_func (void *obj);
+
+/* A cache of equally sized objects carved out of whole pages
+   ("slabs").  See slab.c for details. */
+struct slab_cache {
+	const char *name;           /* For statistics. */
+	size_t obj_size;            /* Requested object size. */
+	size_t stride;              /* Distance between objects. */
+	size_t offset;              /* Offset of first object in a slab. */
+	size_t objs_per_slab;       /* Objects in one slab. */
+	slab_init_func *init;       /* Called on each allocation, or null. */
+
+	struct lock lock;           /* Protects everything below. */
+	struct list partial;        /* Slabs with used and free objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* Slabs with no used objects. */
+	size_t empty_cnt;           /* Length of EMPTY. */
+	size_t slab_cnt;            /* Slabs owned. */
+	size_t obj_cnt;             /* Objects in use. */
+};
+
+void slab_cache_init (struct slab_cache *, const char *name,
+		size_t size, size_t align, slab_init_func *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (struct slab_cache *);
+
+#endif /* threads/slab.h */
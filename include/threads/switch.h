@@ -0,0 +1,18 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Switches kernel stacks between two threads.  Saves the
+   callee-saved registers on the current stack, stores the stack
+   pointer into *CUR_RSP, then loads NEXT_RSP, restores the
+   registers saved there and returns into the next thread. */
+void switch_threads (uint64_t *cur_rsp, uint64_t next_rsp);
+
+/* Like switch_threads(), but starts a thread that has never run
+   by launching NEXT_TF through do_iret(). */
+void switch_to_new (uint64_t *cur_rsp, struct intr_frame *next_tf);
+
+#endif /* threads/switch.h */
@@ -20,13 +20,55 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+	// donate
+	int max_priority;           /* Highest priority among waiters. */
+	struct list_elem elem;      /* Element in holder's held_locks. */
+
+	// adaptive lock
+	bool adaptive;              /* Spin/yield before blocking? */
+	long long acquire_cnt;      /* # of lock_acquire() calls. */
+	long long contended_cnt;    /* # of acquires that found LOCK held. */
+	long long spin_cnt;         /* # of contended acquires that did not block. */
 };
 
 void lock_init (struct lock *);
+void lock_init_adaptive (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (const struct lock *, const char *name);
+
+/* Max number of rwlocks one thread may hold for reading at once. */
+#define RWLOCK_HOLDS_MAX 4
+
+/* One thread's read hold on an rwlock.  Each thread has
+   RWLOCK_HOLDS_MAX of these in its struct thread. */
+struct rwlock_hold {
+	struct rwlock *rw;          /* Rwlock held for reading, or null if unused. */
+	struct thread *reader;      /* Thread holding it. */
+	struct list_elem elem;      /* Element in RW's readers. */
+};
+
+/* Reader-writer lock.
+   Any number of readers or a single writer may hold it.  A
+   waiting writer keeps new readers out, so writers do not
+   starve. */
+struct rwlock {
+	struct lock lock;           /* Held by the writer, briefly by readers. */
+	struct semaphore drain;     /* Writer waits here for readers to leave. */
+	int reader_cnt;             /* # of threads holding read access. */
+	struct thread *writer;      /* Writer waiting for readers to drain. */
+	struct list readers;        /* Read holds (rwlock_hold->elem). */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
 
 /* Condition variable. */
 struct condition {
@@ -39,11 +81,10 @@ void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
 bool cmp_sema(const struct list_elem *curr_elem, const struct list_elem *e, void *aux);			// compare sema's priority
-bool cmp_d_priority(const struct list_elem *curr_elem, const struct list_elem *e, void *aux);	// compare d_elem's priority
-void donate_priority(struct lock *lock);														// donate priority
+void donate_priority(struct lock *lock, int priority);										// donate priority
 
-void remove_lock(struct lock *lock);	// remove next holder
-void refresh_lock(struct lock *lock);	// refresh current holder's priority
+struct thread;
+void refresh_priority(struct thread *t);	// refresh holder's priority from held locks
 
 /* Optimization barrier.
  *
@@ -36,6 +36,17 @@ typedef int tid_t;
 #define INITIAL_RECENT_CPU 0			// define INTIAL_RECENT_CPU
 #define INITIAL_NICE 0					// define INITIAL_NICE
 
+/* Time slices, in timer ticks. */
+#define TIME_SLICE 4                    /* Default time slice. */
+#define TIME_SLICE_MIN 1                /* Shortest time slice. */
+#define TIME_SLICE_MAX 100              /* Longest time slice. */
+
+/* Stride scheduling. */
+#define STRIDE1 (1 << 20)               /* Stride of a thread with 1 ticket. */
+#define TICKETS_MIN 1                   /* Fewest tickets. */
+#define TICKETS_DEFAULT 100             /* Default tickets. */
+#define TICKETS_MAX 10000               /* Most tickets. */
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -106,8 +117,9 @@ struct thread {
 	// donate
 	int original_priority;				// original_priority
 	struct lock *wait_on_lock;			// 기다리고 있는 lock
-	struct list donors;					// waiters와 같다
-	struct list_elem d_elem;			// elem과 같다
+	struct list held_locks;				// 가지고 있는 lock들 (lock->elem)
+	struct rwlock *wait_on_rwlock;		// writer로서 reader가 빠지길 기다리는 rwlock
+	struct rwlock_hold read_holds[RWLOCK_HOLDS_MAX];	// read로 가지고 있는 rwlock들
 
 	// mlfqs
 	struct list_elem m_elem;			// mlfqs_list의 elem
@@ -115,6 +127,25 @@ struct thread {
 	int nice;
 	int recent_cpu;
 
+	// stride
+	int tickets;						// CPU 몫
+	int64_t stride;						// STRIDE1 / tickets
+	int64_t pass;						// 가장 작은 pass가 다음에 실행
+
+	int time_slice;						// 한 번에 실행할 수 있는 tick 수
+
+	// scheduler accounting (TSC cycles)
+	uint64_t last_tsc;					// 마지막으로 상태가 바뀐 시점
+	uint64_t run_tsc;					// 실행한 시간
+	uint64_t ready_tsc;					// ready_list에서 기다린 시간
+	uint64_t wakeup_tsc;				// wakeup부터 실행까지 걸린 시간의 합
+	uint64_t max_wakeup_tsc;			// 그 중 최댓값
+	unsigned wakeup_cnt;				// unblock 된 횟수
+	unsigned voluntary_cnt;				// block/exit/yield로 CPU를 내놓은 횟수
+	unsigned involuntary_cnt;			// 선점으로 CPU를 뺏긴 횟수
+	bool woken;							// unblock 후 아직 실행되지 않음
+	bool preempted;						// 선점되어 양보하는 중
+
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 	struct intr_frame *intr_frame_ptr;
@@ -159,7 +190,9 @@ struct thread {
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
+	uint64_t switch_rsp;                /* Saved kernel rsp, 0 if never run. */
+	void *fpu_state;                    /* FXSAVE area, null until first use. */
+	struct intr_frame tf;               /* Information for first launch */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -178,11 +211,24 @@ struct multiple_ready_queue {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use stride scheduling: threads get CPU time in
+   proportion to their tickets, and priorities only matter for
+   the order of lock and semaphore waiters.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* If true, print per-thread scheduler accounting and the context
+   switch trace.  Controlled by kernel command-line option
+   "-sched-trace". */
+extern bool thread_sched_trace;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_print_sched_stats (const struct thread *);
+void thread_dump_switch_trace (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -200,6 +246,12 @@ void thread_yield (void);
 int thread_get_priority (void);
 void thread_set_priority (int);
 
+bool thread_set_time_slice (int);
+int thread_get_time_slice (void);
+
+bool thread_set_tickets (int);
+int thread_get_tickets (void);
+
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
@@ -207,10 +259,18 @@ int thread_get_load_avg (void);
 
 void do_iret (struct intr_frame *tf);
 
+bool thread_reap (void);
+
+#ifdef USERPROG
+struct file **fd_table_alloc (void);
+void fd_table_free (struct file **);
+#endif
+
 void thread_sleep (int64_t ticks);
 void thread_wakeup (int64_t ticks);
 
 bool cmp_priority(const struct list_elem *curr_elem, const struct list_elem *e, void *aux);	// compare priority
+bool cmp_pass(const struct list_elem *curr_elem, const struct list_elem *e, void *aux);		// compare pass
 void thread_preempt(void);
 
 int int_to_fp (int n);
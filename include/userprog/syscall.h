@@ -1,8 +1,13 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include "threads/slab.h"
+
 typedef int pid_t;
 
+/* Cache of struct exit_info, freed by the parent in process.c. */
+extern struct slab_cache exit_info_cache;
+
 void syscall_init (void);
 void _exit (int status);
 
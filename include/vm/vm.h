@@ -2,6 +2,8 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/slab.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -75,6 +77,9 @@ struct load_info {
 	size_t page_read_bytes;
 };
 
+/* Cache of struct load_info, shared by vm/ and userprog/. */
+extern struct slab_cache load_info_cache;
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -96,6 +101,7 @@ struct page_operations {
  * All designs up to you for this. */
 struct supplemental_page_table {
 	struct hash supplemental_page_hash;
+	struct rwlock spt_lock;		// 조회는 동시에, 삽입은 혼자
 };
 
 #include "threads/thread.h"
@@ -109,6 +115,7 @@ bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -26,6 +26,7 @@ typedef unsigned long elem_type;
    simulates an array of bits. */
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
+	size_t hint;        /* Where bitmap_scan_and_flip() looks first. */
 	elem_type *bits;    /* Elements that represent bits. */
 };
 
@@ -63,6 +64,53 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns an elem_type with bits LO through HI - 1 turned on,
+   where LO < HI <= ELEM_BITS. */
+static inline elem_type
+range_mask (size_t lo, size_t hi) {
+	elem_type high = hi == ELEM_BITS ? (elem_type) -1 : ((elem_type) 1 << hi) - 1;
+	return high & ~(((elem_type) 1 << lo) - 1);
+}
+
+/* Returns the index of the lowest bit set in X, which must not
+   be zero. */
+static inline size_t
+first_set (elem_type x) {
+	elem_type idx;
+
+	asm ("bsfq %1, %0" : "=r" (idx) : "rm" (x) : "cc");
+	return idx;
+}
+
+/* Returns the number of bits set in X.  Done in software because
+   POPCNT is not available on every CPU we run on (e.g. qemu64). */
+static inline size_t
+count_set (elem_type x) {
+	x = x - ((x >> 1) & 0x5555555555555555UL);
+	x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (x * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit at or after START in B that
+   is set to VALUE, or B's size if there is none.  Skips whole
+   elements that cannot contain such a bit. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, bool value) {
+	while (start < b->bit_cnt) {
+		size_t idx = elem_idx (start);
+		elem_type e = value ? b->bits[idx] : ~b->bits[idx];
+
+		e &= ~(bit_mask (start) - 1);
+		if (e != 0) {
+			size_t bit = idx * ELEM_BITS + first_set (e);
+			return bit < b->bit_cnt ? bit : b->bit_cnt;
+		}
+		start = (idx + 1) * ELEM_BITS;
+	}
+	return b->bit_cnt;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -74,6 +122,7 @@ bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
+		b->hint = 0;
 		b->bits = malloc (byte_cnt (bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all (b, false);
@@ -94,6 +143,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 	ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
 	b->bit_cnt = bit_cnt;
+	b->hint = 0;
 	b->bits = (elem_type *) (b + 1);
 	bitmap_set_all (b, false);
 	return b;
@@ -194,33 +244,51 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.  Each
+   element is updated atomically, as by bitmap_mark() and
+   bitmap_reset(). */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	while (cnt > 0) {
+		size_t idx = elem_idx (start);
+		size_t lo = start % ELEM_BITS;
+		size_t n = cnt < ELEM_BITS - lo ? cnt : ELEM_BITS - lo;
+		elem_type mask = range_mask (lo, lo + n);
+
+		if (value)
+			asm ("lock orq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+		start += n;
+		cnt -= n;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t value_cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
 	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
+	while (cnt > 0) {
+		size_t idx = elem_idx (start);
+		size_t lo = start % ELEM_BITS;
+		size_t n = cnt < ELEM_BITS - lo ? cnt : ELEM_BITS - lo;
+		elem_type e = value ? b->bits[idx] : ~b->bits[idx];
+
+		value_cnt += count_set (e & range_mask (lo, lo + n));
+		start += n;
+		cnt -= n;
+	}
 	return value_cnt;
 }
 
@@ -228,16 +296,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return cnt > 0 && next_bit (b, start, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -272,12 +335,20 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+	if (cnt == 0)
+		return start;
+	while (start + cnt <= b->bit_cnt) {
+		size_t end;
+
+		/* Jump to the next bit with VALUE, then to the end of
+		   its run. */
+		start = next_bit (b, start, value);
+		if (start + cnt > b->bit_cnt)
+			break;
+		end = next_bit (b, start, !value);
+		if (end - start >= cnt)
+			return start;
+		start = end;
 	}
 	return BITMAP_ERROR;
 }
@@ -286,14 +357,26 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    START that are all set to VALUE, flips them all to !VALUE,
    and returns the index of the first bit in the group.
    If there is no such group, returns BITMAP_ERROR.
-   If CNT is zero, returns 0.
+   If CNT is zero, returns START.
    Bits are set atomically, but testing bits is not atomic with
-   setting them. */
+   setting them.
+
+   The search is next-fit: it begins where the previous group
+   found by this function ended, if that is past START, and wraps
+   around to START if nothing is found there.  So the group
+   returned is not necessarily the first one after START. */
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t idx = bitmap_scan (b, start, cnt, value);
-	if (idx != BITMAP_ERROR)
+	size_t idx = BITMAP_ERROR;
+
+	if (b->hint > start && b->hint < b->bit_cnt)
+		idx = bitmap_scan (b, b->hint, cnt, value);
+	if (idx == BITMAP_ERROR)
+		idx = bitmap_scan (b, start, cnt, value);
+	if (idx != BITMAP_ERROR) {
 		bitmap_set_multiple (b, idx, cnt, !value);
+		b->hint = idx + cnt;
+	}
 	return idx;
 }
 
@@ -9,6 +9,15 @@
 
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void putbuf_have_lock (const char *buffer, size_t n);
+
+/* vprintf() output is collected here and written in bulk. */
+#define VPRINTF_BUFSIZE 64
+struct vprintf_aux {
+	int char_cnt;                   /* Characters printed so far. */
+	size_t len;                     /* Bytes waiting in buf. */
+	char buf[VPRINTF_BUFSIZE];
+};
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,6 +68,9 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* False if output should go to the serial port only. */
+static bool use_vga = true;
+
 /* Enable console locking. */
 void
 console_init (void) {
@@ -66,6 +78,14 @@ console_init (void) {
 	use_console_lock = true;
 }
 
+/* Stops echoing console output to the vga display.  Used when
+   nobody is looking at it, since vga_putc() is the slower half
+   of every character. */
+void
+console_disable_vga (void) {
+	use_vga = false;
+}
+
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
    now on. */
@@ -116,13 +136,16 @@ console_locked_by_current_thread (void) {
    Writes its output to both vga display and serial port. */
 int
 vprintf (const char *format, va_list args) {
-	int char_cnt = 0;
+	struct vprintf_aux aux;
 
+	aux.char_cnt = 0;
+	aux.len = 0;
 	acquire_console ();
-	__vprintf (format, args, vprintf_helper, &char_cnt);
+	__vprintf (format, args, vprintf_helper, &aux);
+	putbuf_have_lock (aux.buf, aux.len);
 	release_console ();
 
-	return char_cnt;
+	return aux.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
@@ -142,8 +165,7 @@ puts (const char *s) {
 void
 putbuf (const char *buffer, size_t n) {
 	acquire_console ();
-	while (n-- > 0)
-		putchar_have_lock (*buffer++);
+	putbuf_have_lock (buffer, n);
 	release_console ();
 }
 
@@ -159,10 +181,15 @@ putchar (int c) {
 
 /* Helper function for vprintf(). */
 static void
-vprintf_helper (char c, void *char_cnt_) {
-	int *char_cnt = char_cnt_;
-	(*char_cnt)++;
-	putchar_have_lock (c);
+vprintf_helper (char c, void *aux_) {
+	struct vprintf_aux *aux = aux_;
+
+	aux->char_cnt++;
+	if (aux->len == sizeof aux->buf) {
+		putbuf_have_lock (aux->buf, aux->len);
+		aux->len = 0;
+	}
+	aux->buf[aux->len++] = c;
 }
 
 /* Writes C to the vga display and serial port.
@@ -173,5 +200,20 @@ putchar_have_lock (uint8_t c) {
 	ASSERT (console_locked_by_current_thread ());
 	write_cnt++;
 	serial_putc (c);
-	vga_putc (c);
+	if (use_vga)
+		vga_putc (c);
+}
+
+/* Writes the N characters in BUFFER to the vga display and serial
+   port, handing them to the serial driver in one call.
+   The caller has already acquired the console lock if
+   appropriate. */
+static void
+putbuf_have_lock (const char *buffer, size_t n) {
+	ASSERT (console_locked_by_current_thread ());
+	write_cnt += n;
+	serial_putbuf ((const uint8_t *) buffer, n);
+	if (use_vga)
+		while (n-- > 0)
+			vga_putc (*buffer++);
 }
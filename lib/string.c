@@ -1,6 +1,31 @@
 #include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
+/* An 8-byte word that may be unaligned and may alias any other
+   type, for the word-at-a-time loops below. */
+typedef uint64_t word_t __attribute__ ((may_alias, aligned (1)));
+
+/* Blocks at least this large are moved with string instructions
+   rather than by the word loops. */
+#define REP_THRESHOLD 256
+
+/* Returns true if the CPU has enhanced REP MOVSB/STOSB (ERMS), in
+   which case the byte forms are as fast as the quadword forms. */
+static bool
+has_erms (void) {
+	static int erms = -1;
+
+	if (erms < 0) {
+		uint32_t eax = 7, ebx, ecx = 0, edx;
+		__asm __volatile ("cpuid"
+				: "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+		erms = (ebx >> 9) & 1;
+	}
+	return erms;
+}
+
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
 void *
@@ -11,6 +36,23 @@ memcpy (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
+	if (size >= REP_THRESHOLD) {
+		if (!has_erms ()) {
+			size_t words = size / sizeof (word_t);
+			__asm __volatile ("rep movsq"
+					: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+			size %= sizeof (word_t);
+		}
+		__asm __volatile ("rep movsb"
+				: "+D" (dst), "+S" (src), "+c" (size) : : "memory");
+		return dst_;
+	}
+
+	for (; size >= sizeof (word_t); size -= sizeof (word_t)) {
+		*(word_t *) dst = *(const word_t *) src;
+		dst += sizeof (word_t);
+		src += sizeof (word_t);
+	}
 	while (size-- > 0)
 		*dst++ = *src++;
 
@@ -52,6 +94,15 @@ memcmp (const void *a_, const void *b_, size_t size) {
 	ASSERT (a != NULL || size == 0);
 	ASSERT (b != NULL || size == 0);
 
+	/* Skip equal words; the differing byte, if any, is found by
+	   the byte loop. */
+	for (; size >= sizeof (word_t); size -= sizeof (word_t)) {
+		if (*(const word_t *) a != *(const word_t *) b)
+			break;
+		a += sizeof (word_t);
+		b += sizeof (word_t);
+	}
+
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -260,6 +311,26 @@ memset (void *dst_, int value, size_t size) {
 
 	ASSERT (dst != NULL || size == 0);
 
+	if (size >= REP_THRESHOLD) {
+		if (!has_erms ()) {
+			size_t words = size / sizeof (word_t);
+			uint64_t pattern = (unsigned char) value * 0x0101010101010101ULL;
+			__asm __volatile ("rep stosq"
+					: "+D" (dst), "+c" (words) : "a" (pattern) : "memory");
+			size %= sizeof (word_t);
+		}
+		__asm __volatile ("rep stosb"
+				: "+D" (dst), "+c" (size) : "a" (value) : "memory");
+		return dst_;
+	}
+
+	if (size >= sizeof (word_t)) {
+		word_t pattern = (unsigned char) value * 0x0101010101010101ULL;
+		for (; size >= sizeof (word_t); size -= sizeof (word_t)) {
+			*(word_t *) dst = pattern;
+			dst += sizeof (word_t);
+		}
+	}
 	while (size-- > 0)
 		*dst++ = value;
 
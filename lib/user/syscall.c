@@ -145,6 +145,16 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+bool
+set_tickets (int tickets) {
+	return syscall1 (SYS_SET_TICKETS, tickets);
+}
+
+bool
+set_time_slice (int ticks) {
+	return syscall1 (SYS_SET_TIME_SLICE, ticks);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -0,0 +1,67 @@
+/* Checks that realloc() keeps a block where it is when it can:
+   a small block while the new size belongs to the same size
+   class, and a big block when it shrinks, or grows into the
+   pages right after it.  A small block that outgrows its class
+   must move, keeping its contents. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+void
+test_malloc_realloc (void) 
+{
+  enum intr_level old_level;
+  char *p, *q;
+  uintptr_t addr;
+  size_t i;
+
+  p = malloc (100);
+  ASSERT (p != NULL);
+  msg ("malloc (100) gives %zu usable bytes.", malloc_usable_size (p));
+  memset (p, 'a', 100);
+
+  /* Compare addresses, since P may not be used once realloc()
+     moves the block. */
+  addr = (uintptr_t) p;
+  p = realloc (p, 128);
+  if ((uintptr_t) p != addr)
+    fail ("Growing within the size class moved the block.");
+  p = realloc (p, 65);
+  if ((uintptr_t) p != addr)
+    fail ("Shrinking within the size class moved the block.");
+  msg ("Resized within the size class in place.");
+
+  q = realloc (p, 129);
+  if (q == NULL || (uintptr_t) q == addr)
+    fail ("Growing out of the size class did not move the block.");
+  for (i = 0; i < 65; i++)
+    if (q[i] != 'a')
+      fail ("Byte %zu was lost in the move.", i);
+  msg ("Moved to a block of %zu bytes.", malloc_usable_size (q));
+  free (q);
+
+  /* Interrupts stay off so that no other thread takes the pages
+     freed by the shrink before the grow. */
+  p = malloc (3 * PGSIZE);
+  ASSERT (p != NULL);
+  addr = (uintptr_t) p;
+  old_level = intr_disable ();
+  p = realloc (p, PGSIZE);
+  if ((uintptr_t) p != addr)
+    fail ("Shrinking a big block moved it.");
+  if (malloc_usable_size (p) >= 2 * PGSIZE)
+    fail ("Shrinking a big block kept its pages.");
+  p = realloc (p, 3 * PGSIZE);
+  if ((uintptr_t) p != addr)
+    fail ("Growing a big block into free pages moved it.");
+  intr_set_level (old_level);
+  if (malloc_usable_size (p) < 3 * PGSIZE)
+    fail ("Growing a big block did not add pages.");
+  msg ("Resized a big block in place.");
+  free (p);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-realloc) begin
+(malloc-realloc) malloc (100) gives 128 usable bytes.
+(malloc-realloc) Resized within the size class in place.
+(malloc-realloc) Moved to a block of 256 bytes.
+(malloc-realloc) Resized a big block in place.
+(malloc-realloc) end
+EOF
+pass;
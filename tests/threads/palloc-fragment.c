@@ -0,0 +1,64 @@
+/* Takes an aligned block of 8 pages, then all the other pages
+   of the kernel pool, and frees pages 1 through 3 of the block.
+   Those three pages are the only free memory left, and no
+   aligned block of 4 pages is free, so the buddy lists alone
+   cannot satisfy a 3-page request.  palloc_get_multiple() must
+   still find the run and return it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+void
+test_palloc_fragment (void) 
+{
+  uint8_t *block, *run;
+  void *taken = NULL, *page;
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  block = palloc_get_multiple (0, 8);
+  ASSERT (block != NULL);
+
+  /* Take all the other free pages, chained through their first
+     word. */
+  while ((page = palloc_get_page (0)) != NULL)
+    {
+      *(void **) page = taken;
+      taken = page;
+      cnt++;
+    }
+  msg ("Took the rest of the kernel pool.");
+
+  /* Interrupts stay off so that no other thread takes the pages
+     in between. */
+  old_level = intr_disable ();
+  palloc_free_multiple (block + PGSIZE, 3);
+  run = palloc_get_multiple (0, 3);
+  intr_set_level (old_level);
+
+  if (run == NULL)
+    fail ("3-page allocation failed with 3 free pages in a row.");
+  if (run != block + PGSIZE)
+    fail ("3-page allocation returned the wrong pages.");
+  msg ("Got the 3 free pages in a row.");
+
+  palloc_free_multiple (run, 3);
+  palloc_free_page (block);
+  palloc_free_multiple (block + 4 * PGSIZE, 4);
+  while (taken != NULL)
+    {
+      page = taken;
+      taken = *(void **) page;
+      palloc_free_page (page);
+      cnt--;
+    }
+  ASSERT (cnt == 0);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-fragment) begin
+(palloc-fragment) Took the rest of the kernel pool.
+(palloc-fragment) Got the 3 free pages in a row.
+(palloc-fragment) end
+EOF
+pass;
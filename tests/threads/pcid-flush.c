@@ -0,0 +1,66 @@
+/* Maps a user page in a new page table, reads it through that
+   table, and switches back to the kernel's.  While the new table
+   is inactive, the page is remapped to another frame, once with
+   pml4_clear_page() and once with pml4_clear_range().  Each time
+   the table is activated again, the read must see the new frame,
+   not a translation left in the TLB under its PCID.
+
+   QEMU's default CPU has no PCIDs, so run this test with
+   PINTOSOPTS='--cpu qemu64,+pcid,+invpcid' (or qemu64,+pcid) to
+   exercise them. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+
+#define UPAGE ((void *) 0x10000000)
+
+static int read_through (uint64_t *);
+
+void
+test_pcid_flush (void) 
+{
+  uint64_t *pml4;
+  uint8_t *a, *b;
+
+  pml4 = pml4_create ();
+  a = palloc_get_page (PAL_ZERO);
+  b = palloc_get_page (PAL_ZERO);
+  ASSERT (pml4 != NULL && a != NULL && b != NULL);
+  a[0] = 1;
+  b[0] = 2;
+
+  ASSERT (pml4_set_page (pml4, UPAGE, a, false));
+  msg ("Read %d through the first mapping.", read_through (pml4));
+
+  pml4_clear_page (pml4, UPAGE);
+  ASSERT (pml4_set_page (pml4, UPAGE, b, false));
+  msg ("Read %d after pml4_clear_page.", read_through (pml4));
+
+  pml4_clear_range (pml4, UPAGE, UPAGE + PGSIZE);
+  ASSERT (pml4_set_page (pml4, UPAGE, a, false));
+  msg ("Read %d after pml4_clear_range.", read_through (pml4));
+
+  /* pml4_destroy() frees A along with the page table. */
+  pml4_destroy (pml4);
+  palloc_free_page (b);
+}
+
+/* Activates PML4, reads the byte at UPAGE, and activates the
+   kernel's page table again.  Interrupts stay off so that no
+   thread switch loads another page table in between. */
+static int
+read_through (uint64_t *pml4) 
+{
+  enum intr_level old_level = intr_disable ();
+  int value;
+
+  pml4_activate (pml4);
+  value = *(volatile uint8_t *) UPAGE;
+  pml4_activate (NULL);
+  intr_set_level (old_level);
+  return value;
+}
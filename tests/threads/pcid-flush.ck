@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pcid-flush) begin
+(pcid-flush) Read 1 through the first mapping.
+(pcid-flush) Read 2 after pml4_clear_page.
+(pcid-flush) Read 1 after pml4_clear_range.
+(pcid-flush) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* The main thread acquires an rwlock for reading and an
+   unrelated lock.  Then it creates a higher-priority writer,
+   which waits for the main thread to leave the rwlock and
+   donates its priority to it.  Releasing the unrelated lock and
+   lowering the main thread's own priority must not take the
+   donation away; only releasing the rwlock does. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+
+void
+test_priority_donate_rwlock_release (void) 
+{
+  struct rwlock rw;
+  struct lock lock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  lock_init (&lock);
+  rwlock_acquire_read (&rw);
+  lock_acquire (&lock);
+  thread_create ("writer", PRI_DEFAULT + 3, writer_thread_func, &rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+
+  lock_release (&lock);
+  msg ("Released the unrelated lock.");
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+
+  thread_set_priority (PRI_DEFAULT - 10);
+  msg ("Lowered the base priority to %d.", PRI_DEFAULT - 10);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+
+  rwlock_release_read (&rw);
+  msg ("writer must already have finished.");
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT - 10, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer: got the write lock");
+  rwlock_release_write (rw);
+  msg ("writer: done");
+}
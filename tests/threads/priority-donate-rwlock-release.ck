@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock-release) begin
+(priority-donate-rwlock-release) Main thread should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock-release) Released the unrelated lock.
+(priority-donate-rwlock-release) Main thread should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock-release) Lowered the base priority to 21.
+(priority-donate-rwlock-release) Main thread should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock-release) writer: got the write lock
+(priority-donate-rwlock-release) writer: done
+(priority-donate-rwlock-release) writer must already have finished.
+(priority-donate-rwlock-release) Main thread should have priority 21.  Actual priority: 21.
+(priority-donate-rwlock-release) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* The main thread acquires an rwlock for reading.  Then it
+   creates three higher-priority threads that acquire it for
+   reading too, which must not block, and then wait on a
+   semaphore while they still hold it.  When the main thread ups
+   the semaphore, the readers should leave in priority order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_and_sema 
+  {
+    struct rwlock rw;
+    struct semaphore sema;
+  };
+
+static thread_func reader_thread_func;
+
+void
+test_rwlock_readers (void) 
+{
+  struct rwlock_and_sema rs;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rs.rw);
+  sema_init (&rs.sema, 0);
+  rwlock_acquire_read (&rs.rw);
+  for (i = 1; i <= 3; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader%d", i);
+      thread_create (name, PRI_DEFAULT + i, reader_thread_func, &rs);
+    }
+  msg ("%d threads hold the lock for reading.", rs.rw.reader_cnt);
+  for (i = 0; i < 3; i++)
+    sema_up (&rs.sema);
+  rwlock_release_read (&rs.rw);
+  msg ("reader3, reader2, reader1 must already have finished, in that order.");
+}
+
+static void
+reader_thread_func (void *rs_) 
+{
+  struct rwlock_and_sema *rs = rs_;
+
+  rwlock_acquire_read (&rs->rw);
+  msg ("%s: got the read lock", thread_name ());
+  sema_down (&rs->sema);
+  rwlock_release_read (&rs->rw);
+  msg ("%s: done", thread_name ());
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) reader1: got the read lock
+(rwlock-readers) reader2: got the read lock
+(rwlock-readers) reader3: got the read lock
+(rwlock-readers) 4 threads hold the lock for reading.
+(rwlock-readers) reader3: done
+(rwlock-readers) reader2: done
+(rwlock-readers) reader1: done
+(rwlock-readers) reader3, reader2, reader1 must already have finished, in that order.
+(rwlock-readers) end
+EOF
+pass;
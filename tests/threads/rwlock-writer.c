@@ -0,0 +1,58 @@
+/* The main thread acquires an rwlock for reading.  Then it
+   creates a writer, which must wait for the main thread to
+   leave, and after that a higher-priority reader.  Although the
+   lock is only held for reading, the new reader must queue
+   behind the waiting writer.  When the main thread releases the
+   lock, the writer should get it first and the reader right
+   after it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_rwlock_writer (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  thread_create ("reader", PRI_DEFAULT + 2, reader_thread_func, &rw);
+  msg ("Releasing the read lock.");
+  rwlock_release_read (&rw);
+  msg ("writer, reader must already have finished, in that order.");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer: got the write lock");
+  rwlock_release_write (rw);
+  msg ("writer: done");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("reader: got the read lock");
+  rwlock_release_read (rw);
+  msg ("reader: done");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Releasing the read lock.
+(rwlock-writer) writer: got the write lock
+(rwlock-writer) reader: got the read lock
+(rwlock-writer) reader: done
+(rwlock-writer) writer: done
+(rwlock-writer) writer, reader must already have finished, in that order.
+(rwlock-writer) end
+EOF
+pass;
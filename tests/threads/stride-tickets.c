@@ -0,0 +1,33 @@
+/* Checks that thread_set_tickets() accepts TICKETS_MIN through
+   TICKETS_MAX tickets, and rejects values outside that range
+   without changing the thread's tickets. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+
+static void try_tickets (int tickets);
+
+void
+test_stride_tickets (void) 
+{
+  ASSERT (thread_get_tickets () == TICKETS_DEFAULT);
+
+  try_tickets (0);
+  try_tickets (-1);
+  try_tickets (TICKETS_MAX + 1);
+  try_tickets (TICKETS_MIN);
+  try_tickets (TICKETS_MAX);
+  try_tickets (TICKETS_DEFAULT);
+}
+
+/* Sets the running thread's tickets to TICKETS and reports the
+   result and the tickets it has afterward. */
+static void
+try_tickets (int tickets) 
+{
+  bool ok = thread_set_tickets (tickets);
+
+  msg ("%d tickets %s, thread has %d.",
+       tickets, ok ? "accepted" : "rejected", thread_get_tickets ());
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stride-tickets) begin
+(stride-tickets) 0 tickets rejected, thread has 100.
+(stride-tickets) -1 tickets rejected, thread has 100.
+(stride-tickets) 10001 tickets rejected, thread has 100.
+(stride-tickets) 1 tickets accepted, thread has 1.
+(stride-tickets) 10000 tickets accepted, thread has 10000.
+(stride-tickets) 100 tickets accepted, thread has 100.
+(stride-tickets) end
+EOF
+pass;
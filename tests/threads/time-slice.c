@@ -0,0 +1,33 @@
+/* Checks that thread_set_time_slice() accepts TIME_SLICE_MIN
+   through TIME_SLICE_MAX ticks, and rejects values outside that
+   range without changing the thread's time slice. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+
+static void try_time_slice (int ticks);
+
+void
+test_time_slice (void) 
+{
+  ASSERT (thread_get_time_slice () == TIME_SLICE);
+
+  try_time_slice (0);
+  try_time_slice (-1);
+  try_time_slice (TIME_SLICE_MAX + 1);
+  try_time_slice (TIME_SLICE_MIN);
+  try_time_slice (TIME_SLICE_MAX);
+  try_time_slice (TIME_SLICE);
+}
+
+/* Sets the running thread's time slice to TICKS and reports the
+   result and the time slice it has afterward. */
+static void
+try_time_slice (int ticks) 
+{
+  bool ok = thread_set_time_slice (ticks);
+
+  msg ("Time slice of %d %s, thread has %d.",
+       ticks, ok ? "accepted" : "rejected", thread_get_time_slice ());
+}
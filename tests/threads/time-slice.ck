@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(time-slice) begin
+(time-slice) Time slice of 0 rejected, thread has 4.
+(time-slice) Time slice of -1 rejected, thread has 4.
+(time-slice) Time slice of 101 rejected, thread has 4.
+(time-slice) Time slice of 1 accepted, thread has 1.
+(time-slice) Time slice of 100 accepted, thread has 100.
+(time-slice) Time slice of 4 accepted, thread has 4.
+(time-slice) end
+EOF
+pass;
@@ -0,0 +1,188 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Lazy FPU/SSE context switching.
+
+   Most threads never touch the x87 or SSE registers, so we do not
+   save them on every context switch.  Instead, CR0.TS is set
+   whenever a thread other than the current owner of the FPU
+   registers is switched in.  The first FPU or SSE instruction that
+   thread executes then raises #NM, and only at that point do we
+   save the previous owner's registers and load the new thread's.
+
+   A thread gets its save area the first time it traps, so
+   integer-only threads never pay for one.  The area is in FXSAVE
+   format (x87, MMX and SSE state). */
+
+/* CR0 and CR4 bits. */
+#define CR0_MP (1 << 1)         /* Monitor coprocessor. */
+#define CR0_EM (1 << 2)         /* Emulation. */
+#define CR0_TS (1 << 3)         /* Task switched. */
+#define CR4_OSFXSR (1 << 9)     /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT (1 << 10) /* Unmasked SSE exceptions raise #XF. */
+
+/* FXSAVE area. */
+#define FPU_STATE_SIZE 512
+#define FPU_STATE_ALIGN 16
+#define FPU_DEFAULT_FCW 0x037f  /* x87 control word after FNINIT. */
+#define FPU_DEFAULT_MXCSR 0x1f80 /* MXCSR at reset. */
+
+static bool fpu_enabled;        /* Has fpu_init() run? */
+static bool fpu_ts;             /* Is CR0.TS currently set? */
+static struct thread *fpu_owner; /* Thread whose state is in the FPU. */
+
+/* Statistics. */
+static long long fpu_trap_cnt;  /* # of #NM traps. */
+static long long fpu_save_cnt;  /* # of states saved on behalf of a new owner. */
+
+/* Returns T's FXSAVE area, which must exist. */
+static void *
+fpu_area (struct thread *t) {
+	ASSERT (t->fpu_state != NULL);
+	return (void *) ROUND_UP ((uintptr_t) t->fpu_state, FPU_STATE_ALIGN);
+}
+
+static void
+fxsave (void *area) {
+	asm volatile ("fxsave64 %0" : "=m" (*(uint8_t (*)[FPU_STATE_SIZE]) area));
+}
+
+static void
+fxrstor (void *area) {
+	asm volatile ("fxrstor64 %0" : : "m" (*(uint8_t (*)[FPU_STATE_SIZE]) area));
+}
+
+static void
+set_ts (bool ts) {
+	if (ts != fpu_ts) {
+		if (ts)
+			lcr0 (rcr0 () | CR0_TS);
+		else
+			clts ();
+		fpu_ts = ts;
+	}
+}
+
+/* Gives T a save area holding the power-on FPU state.
+   Returns false if memory is not available. */
+static bool
+fpu_alloc (struct thread *t) {
+	uint8_t *area;
+
+	if (t->fpu_state != NULL)
+		return true;
+
+	t->fpu_state = malloc (FPU_STATE_SIZE + FPU_STATE_ALIGN - 1);
+	if (t->fpu_state == NULL)
+		return false;
+
+	area = fpu_area (t);
+	memset (area, 0, FPU_STATE_SIZE);
+	*(uint16_t *) (area + 0) = FPU_DEFAULT_FCW;
+	*(uint32_t *) (area + 24) = FPU_DEFAULT_MXCSR;
+	return true;
+}
+
+/* Enables the FPU and SSE with lazy switching.  Nobody owns the
+   FPU yet, so the first FPU instruction traps. */
+void
+fpu_init (void) {
+	lcr0 ((rcr0 () & ~CR0_EM) | CR0_MP | CR0_TS);
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT);
+	fpu_ts = true;
+	fpu_enabled = true;
+}
+
+/* Called by schedule() right before switching to NEXT.  Arms the
+   #NM trap unless NEXT's state is already in the FPU registers. */
+void
+fpu_switch (struct thread *next) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (fpu_enabled)
+		set_ts (next != fpu_owner);
+}
+
+/* #NM handler: makes the current thread the owner of the FPU,
+   saving the previous owner's registers and loading ours. */
+void
+fpu_handle_nm (struct intr_frame *f) {
+	struct thread *curr = thread_current ();
+
+	fpu_trap_cnt++;
+
+	/* This may sleep, so do it before touching the FPU. */
+	if (!fpu_alloc (curr)) {
+		if (f->cs == SEL_KCSEG)
+			PANIC ("out of memory for FPU state");
+		printf ("%s: dying due to interrupt %#04llx (%s).\n",
+				thread_name (), f->vec_no, intr_name (f->vec_no));
+		thread_exit ();
+	}
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	set_ts (false);
+	if (fpu_owner == curr)
+		return;
+
+	if (fpu_owner != NULL) {
+		fxsave (fpu_area (fpu_owner));
+		fpu_save_cnt++;
+	}
+	fxrstor (fpu_area (curr));
+	fpu_owner = curr;
+}
+
+/* Gives DST, the running thread, a copy of SRC's FPU state, as
+   fork() requires.  Returns false if memory is not available. */
+bool
+fpu_copy (struct thread *dst, struct thread *src) {
+	enum intr_level old_level;
+
+	ASSERT (dst == thread_current ());
+
+	if (src->fpu_state == NULL)
+		return true;
+	if (!fpu_alloc (dst))
+		return false;
+
+	old_level = intr_disable ();
+	if (fpu_owner == src) {
+		/* SRC's latest state is still in the registers. */
+		set_ts (false);
+		fxsave (fpu_area (src));
+		set_ts (dst != fpu_owner);
+	}
+	memcpy (fpu_area (dst), fpu_area (src), FPU_STATE_SIZE);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Releases dying thread T's FPU state. */
+void
+fpu_release (struct thread *t) {
+	enum intr_level old_level = intr_disable ();
+
+	if (fpu_owner == t)
+		fpu_owner = NULL;
+	intr_set_level (old_level);
+
+	free (t->fpu_state);
+	t->fpu_state = NULL;
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void) {
+	printf ("FPU: %lld traps, %lld state saves\n", fpu_trap_cnt, fpu_save_cnt);
+}
@@ -103,6 +103,34 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Interrupt profiling, in TSC cycles.  Handler durations go into
+   a per-vector histogram whose bucket B counts durations in
+   [2^(B + INTR_HIST_SHIFT), 2^(B + INTR_HIST_SHIFT + 1)); the
+   first and last buckets are open-ended. */
+#define INTR_HIST_BUCKETS 16
+#define INTR_HIST_SHIFT 8
+
+struct intr_profile {
+	uint64_t cnt;                           /* Times invoked. */
+	uint64_t cycles;                        /* Total handler time. */
+	uint64_t max_cycles;                    /* Longest handler run. */
+	uint32_t hist[INTR_HIST_BUCKETS];       /* Duration histogram. */
+};
+static struct intr_profile intr_profiles[INTR_CNT];
+
+/* Longest stretch with interrupts off.  A stretch starts when
+   intr_disable() turns interrupts off, or when an interrupt gate
+   does, and ends when intr_enable() or the return from the
+   interrupt turns them back on. */
+static uint64_t off_start;              /* Start of current stretch, or 0. */
+static const void *off_caller;          /* Who started it. */
+static uint64_t off_max;                /* Longest stretch so far. */
+static const void *off_max_caller;      /* Who started that one. */
+
+static enum intr_level disable_from (const void *caller);
+static void off_begin (const void *caller);
+static void off_end (void);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -128,7 +156,8 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	return level == INTR_ON
+		? intr_enable () : disable_from (__builtin_return_address (0));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
@@ -137,6 +166,9 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		off_end ();
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -149,6 +181,14 @@ intr_enable (void) {
 /* Disables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_disable (void) {
+	return disable_from (__builtin_return_address (0));
+}
+
+/* Disables interrupts on behalf of CALLER, which is charged for
+   the time until they are enabled again, and returns the previous
+   interrupt status. */
+static enum intr_level
+disable_from (const void *caller) {
 	enum intr_level old_level = intr_get_level ();
 
 	/* Disable interrupts by clearing the interrupt flag.
@@ -156,9 +196,36 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON)
+		off_begin (caller);
 	return old_level;
 }
 
+/* Starts timing a stretch with interrupts off.  Interrupts must
+   be off. */
+static void
+off_begin (const void *caller) {
+	off_start = rdtsc ();
+	off_caller = caller;
+}
+
+/* Ends the current stretch with interrupts off, if any, and
+   remembers it if it is the longest so far.  Interrupts must be
+   off. */
+static void
+off_end (void) {
+	uint64_t cycles;
+
+	if (off_start == 0)
+		return;
+	cycles = rdtsc () - off_start;
+	if (cycles > off_max) {
+		off_max = cycles;
+		off_max_caller = off_caller;
+	}
+	off_start = 0;
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -332,6 +399,9 @@ void
 intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
+	struct intr_profile *prof;
+	uint64_t start, cycles;
+	int bucket;
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
@@ -348,6 +418,13 @@ intr_handler (struct intr_frame *frame) {
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
+
+	/* If the gate just turned interrupts off, time it from here.
+	   Anything still open was ended by an iret, not by us. */
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+		off_begin ((const void *) handler);
+
+	start = rdtsc ();
 	if (handler != NULL)
 		handler (frame);
 	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
@@ -361,6 +438,22 @@ intr_handler (struct intr_frame *frame) {
 		PANIC ("Unexpected interrupt");
 	}
 
+	/* Account for the handler's run. */
+	cycles = rdtsc () - start;
+	prof = &intr_profiles[frame->vec_no];
+	prof->cnt++;
+	prof->cycles += cycles;
+	if (cycles > prof->max_cycles)
+		prof->max_cycles = cycles;
+	for (bucket = 0; bucket < INTR_HIST_BUCKETS - 1
+			&& cycles >= (2ULL << (bucket + INTR_HIST_SHIFT)); bucket++)
+		continue;
+	prof->hist[bucket]++;
+
+	/* Returning will turn interrupts back on. */
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+		off_end ();
+
 	/* Complete the processing of an external interrupt. */
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
@@ -374,6 +467,29 @@ intr_handler (struct intr_frame *frame) {
 	}
 }
 
+/* Prints per-vector interrupt counts and handler durations, and
+   the longest stretch with interrupts off. */
+void
+intr_print_stats (void) {
+	int vec, b;
+
+	printf ("Interrupts: longest with interrupts off: %llu cycles from %p\n",
+			off_max, off_max_caller);
+	for (vec = 0; vec < INTR_CNT; vec++) {
+		const struct intr_profile *prof = &intr_profiles[vec];
+
+		if (prof->cnt == 0)
+			continue;
+		printf ("  %#04x %-24s %llu times, avg %llu max %llu cycles\n",
+				vec, intr_names[vec], prof->cnt,
+				prof->cycles / prof->cnt, prof->max_cycles);
+		printf ("       histogram (2^%d cycles and up):", INTR_HIST_SHIFT);
+		for (b = 0; b < INTR_HIST_BUCKETS; b++)
+			printf (" %u", prof->hist[b]);
+		printf ("\n");
+	}
+}
+
 /* Dumps interrupt frame F to the console, for debugging. */
 void
 intr_dump_frame (const struct intr_frame *f) {
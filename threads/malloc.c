@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -17,22 +18,43 @@
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
-   Otherwise, a new page of memory, called an "arena", is
+   Otherwise, blocks are carved off the descriptor's current
+   "arena", a page of memory divided into blocks, in order.  Only
+   blocks that have been handed out and freed are ever on the
+   free list.  When the current arena is used up, a new one is
    obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   malloc() returns a null pointer).
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   blocks, we remove its blocks from the free list and either
+   keep the arena for reuse, up to malloc_arena_reserve per
+   descriptor, or give it back to the page allocator.  Keeping a
+   few stops a loop that mallocs and frees one block from getting
+   and freeing a page every time.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   In front of each descriptor's free list sits a "magazine", a
+   small stack of free blocks that malloc() and free() use with
+   interrupts turned off instead of taking the descriptor's lock.
+   There is one CPU, so one magazine per descriptor is a per-CPU
+   cache.  Blocks in a magazine still count as in use by their
+   arenas.  The lock is taken only to refill an empty magazine or
+   drain a full one, half a magazine at a time.
+
+   Each descriptor counts its live blocks, the most ever live at
+   once, and its arenas.  With malloc_track_callers set, every
+   live block's caller is also kept in a table keyed by address,
+   so that malloc_print_stats() can list the call sites that
+   still own memory, which is where leaks show up. */
+
+/* Blocks a magazine holds. */
+#define MAG_SIZE 16
 
 /* Descriptor. */
 struct desc {
@@ -40,6 +62,18 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	struct arena *bump_arena;   /* Arena new blocks come from, or null. */
+	struct list empty_arenas;   /* Unused arenas kept for reuse. */
+	size_t empty_cnt;           /* Length of EMPTY_ARENAS. */
+
+	struct block *mag[MAG_SIZE]; /* Magazine; interrupts off to use. */
+	size_t mag_cnt;             /* Blocks in the magazine. */
+
+	/* Statistics. */
+	size_t live_cnt;            /* Blocks handed out; interrupts off. */
+	size_t peak_cnt;            /* Most blocks ever handed out. */
+	size_t arena_cnt;           /* Arenas; protected by lock. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -50,7 +84,32 @@ struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	size_t bumped;              /* Blocks ever handed out. */
+	struct list_elem elem;      /* In desc's EMPTY_ARENAS. */
+};
+
+/* Number of empty arenas each descriptor keeps instead of
+   returning them to the page allocator. */
+size_t malloc_arena_reserve = 1;
+
+/* Whether to remember the caller of each live block. */
+bool malloc_track_callers;
+
+/* Live block table for malloc_track_callers: open addressing
+   with linear probing, keyed by block address.  Used with
+   interrupts off.  Blocks that do not fit are not tracked. */
+#define CALLER_SLOTS 4096
+struct caller_slot {
+	void *block;                /* Live block, or null if slot is free. */
+	void *caller;               /* Return address of its allocation. */
+	size_t size;                /* Bytes asked for. */
 };
+static struct caller_slot caller_slots[CALLER_SLOTS];
+static size_t caller_cnt;       /* Slots in use. */
+static size_t caller_dropped;   /* Blocks not tracked, table full. */
+
+/* Big blocks handed out; interrupts off. */
+static size_t big_cnt, big_pages, big_peak_pages;
 
 /* Free block. */
 struct block {
@@ -63,6 +122,15 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *desc_get (struct desc *);
+static bool desc_has_free (struct desc *);
+static struct desc *size_to_desc (size_t);
+static bool resize_in_place (void *, size_t);
+static void desc_put (struct desc *, struct block *);
+static void *malloc_from (size_t, void *caller);
+static void note_alloc (struct desc *, void *, size_t, void *caller);
+static void note_free (struct desc *, void *);
+static void note_resize (void *, size_t old_pages, size_t new_size);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -75,7 +143,12 @@ malloc_init (void) {
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		lock_init_adaptive (&d->lock);
+		d->mag_cnt = 0;
+		d->bump_arena = NULL;
+		list_init (&d->empty_arenas);
+		d->empty_cnt = 0;
+		d->live_cnt = d->peak_cnt = d->arena_cnt = 0;
 	}
 }
 
@@ -83,9 +156,16 @@ malloc_init (void) {
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	return malloc_from (size, __builtin_return_address (0));
+}
+
+/* Does the work of malloc() for the call at CALLER. */
+static void *
+malloc_from (size_t size, void *caller) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	enum intr_level old_level;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -93,10 +173,8 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	d = size_to_desc (size);
+	if (d == NULL) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -109,37 +187,85 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		note_alloc (NULL, a + 1, size, caller);
 		return a + 1;
 	}
 
+	/* Fast path: take a block from the magazine. */
+	old_level = intr_disable ();
+	b = d->mag_cnt > 0 ? d->mag[--d->mag_cnt] : NULL;
+	intr_set_level (old_level);
+	if (b != NULL) {
+		note_alloc (d, b, size, caller);
+		return b;
+	}
+
 	lock_acquire (&d->lock);
+	b = desc_get (d);
+	if (b != NULL) {
+		/* Refill half the magazine from blocks already on the free
+		   list while we hold the lock. */
+		struct block *extra[MAG_SIZE / 2];
+		size_t extra_cnt = 0, i = 0;
+
+		while (extra_cnt < MAG_SIZE / 2 && desc_has_free (d))
+			extra[extra_cnt++] = desc_get (d);
+
+		old_level = intr_disable ();
+		while (i < extra_cnt && d->mag_cnt < MAG_SIZE)
+			d->mag[d->mag_cnt++] = extra[i++];
+		intr_set_level (old_level);
+
+		// 그 사이 free()가 magazine을 채웠으면 나머지는 돌려준다
+		while (i < extra_cnt)
+			desc_put (d, extra[i++]);
+	}
+	lock_release (&d->lock);
+	if (b != NULL)
+		note_alloc (d, b, size, caller);
+	return b;
+}
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+/* Takes a block from D's free list, creating a new arena if the
+   list is empty.  Returns a null pointer if memory is not
+   available.  D's lock must be held. */
+static struct block *
+desc_get (struct desc *d) {
+	struct block *b;
+	struct arena *a;
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
+	ASSERT (lock_held_by_current_thread (&d->lock));
 
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
+	/* If the free list is empty, carve a block off the current
+	   arena, starting a new one if it is used up. */
+	if (list_empty (&d->free_list)) {
+		a = d->bump_arena;
+		if (a == NULL || a->bumped == d->blocks_per_arena) {
+			if (!list_empty (&d->empty_arenas)) {
+				a = list_entry (list_pop_front (&d->empty_arenas),
+						struct arena, elem);
+				d->empty_cnt--;
+			} else {
+				a = palloc_get_page (0);
+				if (a == NULL)
+					return NULL;
+				d->arena_cnt++;
+				a->magic = ARENA_MAGIC;
+				a->desc = d;
+				a->free_cnt = d->blocks_per_arena;
+				a->bumped = 0;
+			}
+			d->bump_arena = a;
 		}
+
+		a->free_cnt--;
+		return arena_to_block (a, a->bumped++);
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
 	a->free_cnt--;
-	lock_release (&d->lock);
 	return b;
 }
 
@@ -156,38 +282,95 @@ calloc (size_t a, size_t b) {
 		return NULL;
 
 	/* Allocate and zero memory. */
-	p = malloc (size);
+	p = malloc_from (size, __builtin_return_address (0));
 	if (p != NULL)
 		memset (p, 0, size);
 
 	return p;
 }
 
-/* Returns the number of bytes allocated for BLOCK. */
-static size_t
-block_size (void *block) {
+/* Returns the number of bytes allocated for BLOCK, which may be
+   more than were asked for; all of them may be used.  Returns 0
+   for a null BLOCK. */
+size_t
+malloc_usable_size (void *block) {
 	struct block *b = block;
-	struct arena *a = block_to_arena (b);
-	struct desc *d = a->desc;
+	struct arena *a;
+	struct desc *d;
 
+	if (block == NULL)
+		return 0;
+	a = block_to_arena (b);
+	d = a->desc;
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Returns the descriptor that would serve a SIZE-byte request, or
+   a null pointer if SIZE needs a big block. */
+static struct desc *
+size_to_desc (size_t size) {
+	struct desc *d;
+
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			return d;
+	return NULL;
+}
+
+/* Tries to resize BLOCK to NEW_SIZE bytes without moving it.
+   Returns true if successful. */
+static bool
+resize_in_place (void *block, size_t new_size) {
+	struct arena *a = block_to_arena (block);
+	size_t page_cnt;
+
+	/* A small block stays put as long as NEW_SIZE belongs to the
+	   same size class. */
+	if (a->desc != NULL) {
+		if (size_to_desc (new_size) != a->desc)
+			return false;
+		note_resize (block, 0, new_size);
+		return true;
+	}
+
+	/* A big block shrinks by freeing its tail pages and grows by
+	   taking the free pages right after it. */
+	if (size_to_desc (new_size) != NULL)
+		return false;
+	page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+	if (page_cnt < a->free_cnt) {
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+	} else if (page_cnt > a->free_cnt) {
+		if (!palloc_grow_multiple (a, a->free_cnt, page_cnt))
+			return false;
+	}
+	note_resize (block, a->free_cnt, new_size);
+	a->free_cnt = page_cnt;
+	return true;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
    null pointer.
    A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
-   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK).
+   The block is resized in place when it can be: within its size
+   class, or for big blocks, by freeing or taking pages at its
+   end. */
 void *
 realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
-	} else {
-		void *new_block = malloc (new_size);
+	} else if (old_block != NULL && resize_in_place (old_block, new_size))
+		return old_block;
+	else {
+		void *new_block = malloc_from (new_size,
+				__builtin_return_address (0));
 		if (old_block != NULL && new_block != NULL) {
-			size_t old_size = block_size (old_block);
+			size_t old_size = malloc_usable_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
 			memcpy (new_block, old_block, min_size);
 			free (old_block);
@@ -205,32 +388,40 @@ free (void *p) {
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
 
+		note_free (d, p);
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
 
+			struct block *drain[MAG_SIZE / 2];
+			size_t drain_cnt = 0;
+			enum intr_level old_level;
+
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
+			/* Fast path: keep the block in the magazine.  If it is
+			   full, take out the older half to give back. */
+			old_level = intr_disable ();
+			if (d->mag_cnt == MAG_SIZE) {
+				drain_cnt = MAG_SIZE / 2;
+				memcpy (drain, d->mag, sizeof drain);
+				memmove (d->mag, d->mag + drain_cnt,
+						(MAG_SIZE - drain_cnt) * sizeof *d->mag);
+				d->mag_cnt -= drain_cnt;
+			}
+			d->mag[d->mag_cnt++] = b;
+			intr_set_level (old_level);
 
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
+			if (drain_cnt > 0) {
 				size_t i;
 
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+				lock_acquire (&d->lock);
+				for (i = 0; i < drain_cnt; i++)
+					desc_put (d, drain[i]);
+				lock_release (&d->lock);
 			}
-
-			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -239,6 +430,233 @@ free (void *p) {
 	}
 }
 
+/* Returns block B to D's free list, and its arena to the page
+   allocator if that leaves the arena entirely unused.  D's lock
+   must be held. */
+static void
+desc_put (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, take its blocks off the
+	   free list and keep or free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < a->bumped; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		a->bumped = 0;
+
+		if (a == d->bump_arena)
+			return;		// 계속 여기서 잘라 쓴다
+		if (d->empty_cnt < malloc_arena_reserve) {
+			list_push_front (&d->empty_arenas, &a->elem);
+			d->empty_cnt++;
+		} else {
+			palloc_free_page (a);
+			d->arena_cnt--;
+		}
+	}
+}
+
+/* Returns true if desc_get() can return a block of D without
+   allocating a page.  D's lock must be held. */
+static bool
+desc_has_free (struct desc *d) {
+	return !list_empty (&d->free_list)
+		|| (d->bump_arena != NULL
+				&& d->bump_arena->bumped < d->blocks_per_arena);
+}
+
+/* Returns the slot in caller_slots[] where BLOCK's hash chain
+   starts. */
+static size_t
+caller_hash (const void *block) {
+	uint64_t h = ((uintptr_t) block >> 4) * 0x9e3779b97f4a7c15ULL;
+	return (h >> 32) % CALLER_SLOTS;
+}
+
+/* Returns BLOCK's slot in caller_slots[], or a null pointer if it
+   is not tracked.  Interrupts must be off. */
+static struct caller_slot *
+caller_find (const void *block) {
+	size_t i;
+
+	for (i = caller_hash (block); caller_slots[i].block != NULL;
+			i = (i + 1) % CALLER_SLOTS)
+		if (caller_slots[i].block == block)
+			return &caller_slots[i];
+	return NULL;
+}
+
+/* Counts block P of SIZE bytes, just handed out by D (null for a
+   big block) for the call at CALLER. */
+static void
+note_alloc (struct desc *d, void *p, size_t size, void *caller) {
+	enum intr_level old_level = intr_disable ();
+
+	if (d != NULL) {
+		if (++d->live_cnt > d->peak_cnt)
+			d->peak_cnt = d->live_cnt;
+	} else {
+		big_cnt++;
+		big_pages += block_to_arena (p)->free_cnt;
+		if (big_pages > big_peak_pages)
+			big_peak_pages = big_pages;
+	}
+
+	if (malloc_track_callers) {
+		// 3/4 이상 차면 probe가 길어지니 더 기록하지 않는다
+		if (caller_cnt < CALLER_SLOTS / 4 * 3) {
+			size_t i = caller_hash (p);
+
+			while (caller_slots[i].block != NULL)
+				i = (i + 1) % CALLER_SLOTS;
+			caller_slots[i].block = p;
+			caller_slots[i].caller = caller;
+			caller_slots[i].size = size;
+			caller_cnt++;
+		} else
+			caller_dropped++;
+	}
+	intr_set_level (old_level);
+}
+
+/* Uncounts block P of D (null for a big block), about to be
+   freed. */
+static void
+note_free (struct desc *d, void *p) {
+	enum intr_level old_level = intr_disable ();
+	struct caller_slot *slot;
+
+	if (d != NULL)
+		d->live_cnt--;
+	else {
+		big_cnt--;
+		big_pages -= block_to_arena (p)->free_cnt;
+	}
+
+	/* Remove P's slot, then move later slots of the same probe
+	   run back so that lookups never stop at the hole. */
+	if (malloc_track_callers && (slot = caller_find (p)) != NULL) {
+		size_t i = slot - caller_slots, j;
+
+		for (j = (i + 1) % CALLER_SLOTS; caller_slots[j].block != NULL;
+				j = (j + 1) % CALLER_SLOTS) {
+			size_t k = caller_hash (caller_slots[j].block);
+
+			// k가 (i, j] 밖에 있을 때만 i로 당겨도 찾을 수 있다
+			if (i < j ? k <= i || k > j : k <= i && k > j) {
+				caller_slots[i] = caller_slots[j];
+				i = j;
+			}
+		}
+		caller_slots[i].block = NULL;
+		caller_cnt--;
+	}
+	intr_set_level (old_level);
+}
+
+/* Notes that BLOCK was resized in place to NEW_SIZE bytes.
+   OLD_PAGES is its page count before the resize if it is a big
+   block, otherwise 0. */
+static void
+note_resize (void *block, size_t old_pages, size_t new_size) {
+	enum intr_level old_level = intr_disable ();
+	struct caller_slot *slot;
+
+	if (old_pages != 0) {
+		big_pages = big_pages - old_pages
+			+ DIV_ROUND_UP (new_size + sizeof (struct arena), PGSIZE);
+		if (big_pages > big_peak_pages)
+			big_peak_pages = big_pages;
+	}
+	if (malloc_track_callers && (slot = caller_find (block)) != NULL)
+		slot->size = new_size;
+	intr_set_level (old_level);
+}
+
+/* Call sites listed by malloc_print_stats(). */
+#define CALLER_SITES 16
+struct caller_site {
+	void *caller;               /* Return address. */
+	size_t block_cnt;           /* Live blocks. */
+	size_t bytes;               /* Bytes asked for. */
+};
+
+/* Prints malloc() statistics: per size class, the live and peak
+   block counts and the arenas, and for big blocks, the pages.
+   With malloc_track_callers, also lists the call sites that own
+   the most live memory. */
+void
+malloc_print_stats (void) {
+	static struct caller_site sites[CALLER_SITES];
+	size_t site_cnt = 0, other_cnt = 0, other_bytes = 0;
+	enum intr_level old_level;
+	struct desc *d;
+	size_t i, j;
+
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->peak_cnt > 0)
+			printf ("Malloc %zu-byte blocks: %zu live, peak %zu, "
+					"%zu arenas (%zu empty)\n",
+					d->block_size, d->live_cnt, d->peak_cnt,
+					d->arena_cnt, d->empty_cnt);
+	printf ("Malloc big blocks: %zu live, %zu pages, peak %zu pages\n",
+			big_cnt, big_pages, big_peak_pages);
+
+	if (!malloc_track_callers)
+		return;
+
+	/* Add up live blocks by call site, keeping the sites sorted
+	   by bytes. */
+	old_level = intr_disable ();
+	for (i = 0; i < CALLER_SLOTS; i++) {
+		struct caller_slot *slot = &caller_slots[i];
+		struct caller_site site;
+
+		if (slot->block == NULL)
+			continue;
+		for (j = 0; j < site_cnt; j++)
+			if (sites[j].caller == slot->caller)
+				break;
+		if (j == site_cnt) {
+			if (site_cnt == CALLER_SITES) {
+				other_cnt++;
+				other_bytes += slot->size;
+				continue;
+			}
+			sites[site_cnt].caller = slot->caller;
+			sites[site_cnt].block_cnt = sites[site_cnt].bytes = 0;
+			site_cnt++;
+		}
+		sites[j].block_cnt++;
+		sites[j].bytes += slot->size;
+
+		site = sites[j];
+		for (; j > 0 && sites[j - 1].bytes < site.bytes; j--)
+			sites[j] = sites[j - 1];
+		sites[j] = site;
+	}
+	intr_set_level (old_level);
+
+	printf ("Malloc live blocks by caller (%zu tracked, %zu untracked):\n",
+			caller_cnt, caller_dropped);
+	for (j = 0; j < site_cnt; j++)
+		printf ("  %p: %zu blocks, %zu bytes\n",
+				sites[j].caller, sites[j].block_cnt, sites[j].bytes);
+	if (other_cnt > 0)
+		printf ("  other callers: %zu blocks, %zu bytes\n",
+				other_cnt, other_bytes);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
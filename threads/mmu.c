@@ -8,6 +8,61 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Bytes of virtual memory mapped by one page table. */
+#define PT_SPAN (1UL << PDXSHIFT)
+
+/* Range operations flush a range of at most this many pages
+   from the TLB page by page, and anything larger all at once. */
+#define INVLPG_MAX 32
+
+/* Process-context identifiers (PCIDs).
+
+   Without PCIDs, every CR3 load flushes the TLB.  With CR4.PCIDE
+   set, TLB entries are tagged with the PCID in the low 12 bits of
+   CR3, and a CR3 load with CR3_NOFLUSH set keeps the entries of
+   every PCID, so switching back to a process finds its
+   translations still cached.  base_pml4 uses PCID 0.  Any other
+   pml4 is given one of the other PCID_CNT - 1 when it is first
+   activated, taken round robin from an older pml4 if none is
+   free; the older one gets a new PCID when it runs again.
+
+   Entries of an inactive pml4 are invalidated with INVPCID, or,
+   on CPUs without it, by marking its PCID "stale" so that its
+   next activation flushes.  A newly assigned PCID is stale, since
+   its previous owner's entries may still be cached.
+
+   QEMU's default CPU model has no PCIDs.  To exercise this code,
+   run "pintos --cpu qemu64,+pcid,+invpcid", or "qemu64,+pcid"
+   for the stale-PCID path, and for the test suite
+   "make check PINTOSOPTS='--cpu qemu64,+pcid,+invpcid'".  The
+   pcid-flush test checks that a pml4 changed while inactive sees
+   the change once activated again. */
+#define CPUID_1_ECX_PCID (1 << 17)
+#define CPUID_7_EBX_INVPCID (1 << 10)
+#define CR4_PCIDE (1 << 17)
+#define CR3_NOFLUSH (1ULL << 63)
+#define INVPCID_ADDR 0          /* INVPCID type: one address. */
+#define PCID_CNT 64
+
+static bool pcid_enabled;               /* Is CR4.PCIDE set? */
+static bool invpcid_enabled;            /* Is INVPCID available? */
+static uint64_t *pcid_owner[PCID_CNT];  /* pml4 holding each PCID. */
+static bool pcid_stale[PCID_CNT];       /* Flush at next activation? */
+static unsigned pcid_next = 1;          /* Next PCID to take back. */
+
+/* Kernel mappings.
+
+   All address spaces share the kernel's page directory pointer
+   tables and everything below them, so a new pml4 only needs the
+   base_pml4 slots in [kern_slot_first, kern_slot_last] copied in.
+   The kernel's leaf PTEs are global (PTE_G), so with CR4.PGE set
+   their TLB entries survive CR3 loads.  Kernel mappings never
+   change after paging_init(), so they never need flushing. */
+#define CPUID_1_EDX_PGE (1 << 13)
+#define CR4_PGE (1 << 7)
+
+static unsigned kern_slot_first, kern_slot_last;
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -94,12 +149,104 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
  * allocation fails. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	uint64_t *pml4 = palloc_get_page (PAL_ZERO);
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		memcpy (pml4 + kern_slot_first, base_pml4 + kern_slot_first,
+				(kern_slot_last - kern_slot_first + 1) * sizeof *pml4);
 	return pml4;
 }
 
+/* Finds the base_pml4 slots that pml4_create() copies and makes
+ * global PTEs take effect.  Must be called after base_pml4, with
+ * its kernel PTEs marked PTE_G, is active. */
+void
+pml4_init_global (void) {
+	uint32_t eax, ebx, ecx, edx;
+	unsigned i;
+
+	kern_slot_first = PML4 (KERN_BASE);
+	kern_slot_last = kern_slot_first;
+	for (i = kern_slot_first; i < PGSIZE / sizeof *base_pml4; i++)
+		if (base_pml4[i] & PTE_P)
+			kern_slot_last = i;
+	// user 영역 슬롯은 비어 있어야 한다
+	for (i = 0; i < kern_slot_first; i++)
+		ASSERT (!(base_pml4[i] & PTE_P));
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	if (edx & CPUID_1_EDX_PGE)
+		lcr4 (rcr4 () | CR4_PGE);
+}
+
+/* Turns on PCIDs if the CPU supports them.  Must be called after
+ * base_pml4 is active. */
+void
+pml4_init_pcid (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_1_ECX_PCID))
+		return;
+	cpuid (0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 7) {
+		cpuid (7, 0, &eax, &ebx, &ecx, &edx);
+		invpcid_enabled = (ebx & CPUID_7_EBX_INVPCID) != 0;
+	}
+
+	// PCIDE는 CR3의 PCID가 0일 때만 켤 수 있다
+	ASSERT (rcr3 () == vtop (base_pml4));
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Returns PML4's PCID, or 0 if it has none.  A null PML4 finds a
+ * free PCID.  Interrupts must be off. */
+static unsigned
+pcid_find (const uint64_t *pml4) {
+	unsigned pcid;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	for (pcid = 1; pcid < PCID_CNT; pcid++)
+		if (pcid_owner[pcid] == pml4)
+			return pcid;
+	return 0;
+}
+
+/* Invalidates the TLB entries of inactive PML4 for the pages in
+ * [START, END).  Interrupts must be off. */
+static void
+pcid_flush (const uint64_t *pml4, uint64_t start, uint64_t end) {
+	unsigned pcid;
+
+	if (!pcid_enabled)
+		return;
+	pcid = pcid_find (pml4);
+	if (pcid != 0) {
+		if (invpcid_enabled && (end - start) / PGSIZE <= INVLPG_MAX)
+			for (; start < end; start += PGSIZE)
+				invpcid (INVPCID_ADDR, pcid, start);
+		else
+			pcid_stale[pcid] = true;
+	}
+}
+
+/* Returns true if PML4 is the active page table. */
+static bool
+is_active (const uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Flushes the TLB entry for VA in PML4.  Interrupts must have
+ * been off since the PTE was changed: otherwise PML4 could be
+ * activated in between, keeping its old entry under its PCID. */
+static void
+flush_page (uint64_t *pml4, uint64_t va) {
+	if (is_active (pml4))
+		invlpg (va);
+	else
+		pcid_flush (pml4, va, va + PGSIZE);
+}
+
 static bool
 pt_for_each (uint64_t *pt, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index, unsigned pdx_index) {
@@ -191,6 +338,16 @@ pml4_destroy (uint64_t *pml4) {
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
+	ASSERT (!is_active (pml4));
+
+	// PCID를 반납한다
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		unsigned pcid = pcid_find (pml4);
+		if (pcid != 0)
+			pcid_owner[pcid] = NULL;
+		intr_set_level (old_level);
+	}
 
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
@@ -200,10 +357,43 @@ pml4_destroy (uint64_t *pml4) {
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, the TLB is kept unless PML4's PCID is
+ * stale. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	enum intr_level old_level;
+	uint64_t cr3;
+	unsigned pcid;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	if (!pcid_enabled) {
+		lcr3 (vtop (pml4));
+		return;
+	}
+
+	old_level = intr_disable ();
+	cr3 = vtop (pml4) | CR3_NOFLUSH;
+	if (pml4 != base_pml4) {
+		pcid = pcid_find (pml4);
+		if (pcid == 0) {
+			// 빈 PCID가 없을 때만 다른 pml4의 것을 뺏는다
+			pcid = pcid_find (NULL);
+			if (pcid == 0) {
+				pcid = pcid_next;
+				pcid_next = pcid_next % (PCID_CNT - 1) + 1;
+			}
+			pcid_owner[pcid] = pml4;
+			pcid_stale[pcid] = true;
+		}
+		if (pcid_stale[pcid]) {
+			cr3 &= ~CR3_NOFLUSH;
+			pcid_stale[pcid] = false;
+		}
+		cr3 |= pcid;
+	}
+	lcr3 (cr3);
+	intr_set_level (old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -256,10 +446,125 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
+		enum intr_level old_level = intr_disable ();
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		flush_page (pml4, (uint64_t) upage);
+		intr_set_level (old_level);
+	}
+}
+
+/* Returns the page table that maps VA in PML4, that is, the
+ * entry for the first page of VA's PT_SPAN-aligned region.  If
+ * there is none, behavior depends on CREATE as in pml4e_walk(). */
+static uint64_t *
+pt_walk (uint64_t *pml4, uint64_t va, bool create) {
+	return pml4e_walk (pml4, va & ~(PT_SPAN - 1), create);
+}
+
+/* Flushes the TLB entries for the pages in [START, END) of
+ * PML4.  Reloading CR3 flushes only the active PCID.  Interrupts
+ * must be off, as for flush_page(). */
+static void
+flush_range (uint64_t *pml4, uint64_t start, uint64_t end) {
+	if (!is_active (pml4))
+		pcid_flush (pml4, start, end);
+	else if ((end - start) / PGSIZE > INVLPG_MAX)
+		lcr3 (rcr3 ());
+	else
+		for (; start < end; start += PGSIZE)
+			invlpg (start);
+}
+
+/* Calls FUNC for each present PTE that maps a user page in
+ * [START, END) of PML4, in address order, with the page's
+ * address and AUX.  Each page table is walked to once, not once
+ * per page, and regions without one are skipped.  Stops and
+ * returns false as soon as FUNC does; returns true otherwise.
+ * FUNC may change the PTE but must flush the TLB itself. */
+bool
+pml4_for_each_range (uint64_t *pml4, const void *start, const void *end,
+		pte_for_each_func *func, void *aux) {
+	uint64_t va = (uint64_t) pg_round_down (start);
+
+	ASSERT (is_user_vaddr (start));
+	ASSERT ((uint64_t) end <= KERN_BASE);
+
+	while (va < (uint64_t) end) {
+		uint64_t next = (va | (PT_SPAN - 1)) + 1;
+		uint64_t *pt = pt_walk (pml4, va, false);
+
+		if (next > (uint64_t) end)
+			next = (uint64_t) end;
+		if (pt != NULL) {
+			for (; va < next; va += PGSIZE) {
+				uint64_t *pte = &pt[PTX (va)];
+				if ((*pte & PTE_P) && !func (pte, (void *) va, aux))
+					return false;
+			}
+		}
+		va = (uint64_t) pg_round_up (next);
 	}
+	return true;
+}
+
+/* Marks the user pages in [START, END) "not present" in PML4,
+ * like pml4_clear_page() on each, and flushes them from the TLB
+ * together at the end.  Pages need not be mapped. */
+void
+pml4_clear_range (uint64_t *pml4, void *start, void *end) {
+	uint64_t va = (uint64_t) start;
+	enum intr_level old_level;
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (is_user_vaddr (start));
+	ASSERT ((uint64_t) end <= KERN_BASE);
+
+	old_level = intr_disable ();
+	while (va < (uint64_t) end) {
+		uint64_t next = (va | (PT_SPAN - 1)) + 1;
+		uint64_t *pt = pt_walk (pml4, va, false);
+
+		if (next > (uint64_t) end)
+			next = (uint64_t) end;
+		if (pt != NULL)
+			for (; va < next; va += PGSIZE)
+				pt[PTX (va)] &= ~(uint64_t) PTE_P;
+		va = (uint64_t) pg_round_up (next);
+	}
+	flush_range (pml4, (uint64_t) start, (uint64_t) pg_round_up (end));
+	intr_set_level (old_level);
+}
+
+/* Clears the bits in MASK in the PTE for VPAGE in PML4 and
+ * returns whether any of them were set, walking the page table
+ * once. */
+static bool
+test_and_clear (uint64_t *pml4, const void *vpage, uint64_t mask) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	enum intr_level old_level;
+
+	if (pte == NULL || (*pte & mask) == 0)
+		return false;
+	old_level = intr_disable ();
+	*pte &= ~mask;
+	flush_page (pml4, (uint64_t) vpage);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Returns whether the PTE for VPAGE in PML4 is dirty, and makes
+ * it clean.  Same as pml4_is_dirty() followed by
+ * pml4_set_dirty(..., false), with one walk. */
+bool
+pml4_test_and_clear_dirty (uint64_t *pml4, const void *vpage) {
+	return test_and_clear (pml4, vpage, PTE_D);
+}
+
+/* Returns whether the PTE for VPAGE in PML4 has been accessed,
+ * and clears its accessed bit, with one walk. */
+bool
+pml4_test_and_clear_accessed (uint64_t *pml4, const void *vpage) {
+	return test_and_clear (pml4, vpage, PTE_A);
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
@@ -278,13 +583,14 @@ void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
+		enum intr_level old_level = intr_disable ();
 		if (dirty)
 			*pte |= PTE_D;
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		flush_page (pml4, (uint64_t) vpage);
+		intr_set_level (old_level);
 	}
 }
 
@@ -304,12 +610,13 @@ void
 pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
+		enum intr_level old_level = intr_disable ();
 		if (accessed)
 			*pte |= PTE_A;
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		flush_page (pml4, (uint64_t) vpage);
+		intr_set_level (old_level);
 	}
 }
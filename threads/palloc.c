@@ -10,6 +10,7 @@
 #include "threads/init.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,15 +25,63 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are kept by a buddy allocator: a free
+   block of order K is 2**K pages whose index within the pool is a
+   multiple of 2**K, and it sits on the free list for order K.
+   Allocating splits the smallest large-enough block, and freeing
+   merges a block with its buddy for as long as the buddy is free
+   too, so both take time logarithmic in the pool size.  The
+   bookkeeping lives in a per-page array next to the pool's bitmap
+   rather than in the free pages themselves. */
+
+/* Number of block orders.  Order BUDDY_ORDERS - 1 is 2**19 pages,
+   2 GB, more than any pool. */
+#define BUDDY_ORDERS 20
+
+/* Null page index in buddy free lists. */
+#define BUDDY_NIL UINT32_MAX
+
+/* Buddy bookkeeping for one page. */
+struct buddy_page {
+	uint32_t prev, next;            /* Free list links, if a block head. */
+	int8_t order;                   /* Order if head of a free block, else -1. */
+};
+
+/* Number of pre-zeroed pages kept per pool, and the level below
+   which the zeroing thread is woken to refill it. */
+#define ZERO_CACHE_MAX 32
+#define ZERO_CACHE_LOW 8
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+
+	/* Buddy allocator. */
+	struct buddy_page *pages;       /* One per page in the pool. */
+	size_t page_cnt;                /* Number of pages in the pool. */
+	uint32_t free_head[BUDDY_ORDERS]; /* Free list of each order. */
+	size_t free_blocks[BUDDY_ORDERS]; /* Length of each free list. */
+
+	/* Statistics. */
+	size_t free_cnt;                /* Pages on the free lists. */
+	size_t low_free;                /* Fewest free pages ever. */
+	size_t fail_cnt;                /* Allocations that failed. */
+
+	/* Pages that are allocated in used_map but already zeroed,
+	   ready for single-page PAL_ZERO requests.  Pointers are kept
+	   here rather than in the pages so that they stay zero. */
+	void *zeroed[ZERO_CACHE_MAX];
+	size_t zeroed_cnt;
 };
 
+/* Wakes the zeroing thread. */
+static struct semaphore zero_sema;
+static bool zero_thread_started;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
@@ -42,6 +91,13 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *pool_take (struct pool *, size_t page_cnt);
+static void pool_release (struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_claim (struct pool *, size_t idx, size_t page_cnt);
+static void *zeroed_pop (struct pool *);
+static void zero_thread (void *aux UNUSED);
+static size_t largest_free_run (struct pool *);
+static void pool_print_stats (struct pool *, const char *name);
 
 /* multiboot info */
 struct multiboot_info {
@@ -223,12 +279,12 @@ split:
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_release (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_release (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -250,6 +306,8 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	kernel_pool.low_free = kernel_pool.free_cnt;
+	user_pool.low_free = user_pool.free_cnt;
 	return ext_mem.end;
 }
 
@@ -262,19 +320,39 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
+	bool zeroed = false;
 
 	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	// 0으로 채워진 페이지가 필요하면 미리 채워둔 것부터 쓴다
+	if (page_cnt == 1 && (flags & PAL_ZERO)) {
+		pages = zeroed_pop (pool);
+		zeroed = pages != NULL;
+	}
+	if (pages == NULL)
+		pages = pool_take (pool, page_cnt);
+	// 비트맵이 다 찼으면 zero cache도 내어준다
+	if (pages == NULL && page_cnt == 1) {
+		pages = zeroed_pop (pool);
+		zeroed = pages != NULL;
+	}
 	lock_release (&pool->lock);
-	void *pages;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	// reaper가 밀려 있으면 죽은 thread의 page를 직접 회수하고 다시 시도한다
+	if (pages == NULL && pool == &kernel_pool && thread_reap ()) {
+		lock_acquire (&pool->lock);
+		pages = pool_take (pool, page_cnt);
+		lock_release (&pool->lock);
+	}
+	if (pages == NULL) {
+		lock_acquire (&pool->lock);
+		pool->fail_cnt++;
+		lock_release (&pool->lock);
+	}
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		// 호출한 쪽이 곧바로 쓰므로 cache에 남도록 memset으로 채운다
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -296,6 +374,45 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Tries to extend the PAGE_CNT pages starting at PAGES, which
+   must have come from palloc_get_multiple(), to NEW_CNT pages by
+   taking the free pages right after them.  Returns true if
+   successful, false if those pages are not all free. */
+bool
+palloc_grow_multiple (void *pages, size_t page_cnt, size_t new_cnt) {
+	struct pool *pool;
+	size_t page_idx;
+	bool success = false;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (new_cnt >= page_cnt);
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	new_cnt -= page_cnt;
+	if (new_cnt == 0)
+		return true;
+
+	lock_acquire (&pool->lock);
+	if (page_idx + new_cnt <= pool->page_cnt
+			&& bitmap_none (pool->used_map, page_idx, new_cnt)) {
+		buddy_claim (pool, page_idx, new_cnt);
+		bitmap_set_multiple (pool->used_map, page_idx, new_cnt, true);
+		pool->free_cnt -= new_cnt;
+		if (pool->free_cnt < pool->low_free)
+			pool->low_free = pool->free_cnt;
+		success = true;
+	}
+	lock_release (&pool->lock);
+	return success;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -318,8 +435,10 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	lock_acquire (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_release (pool, page_idx, page_cnt);
+	lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +447,122 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	pool_print_stats (&kernel_pool, "kernel");
+	pool_print_stats (&user_pool, "user");
+}
+
+/* Starts the thread that keeps each pool's cache of zeroed pages
+   filled.  Must be called after thread_start(). */
+void
+palloc_start_zeroing (void) {
+	sema_init (&zero_sema, 0);
+	zero_thread_started = true;
+	thread_create ("zeroer", PRI_MIN, zero_thread, NULL);
+}
+
+/* Copies the page at SRC to the page at DST with non-temporal
+   stores, so that the copy does not evict the cache lines that
+   the copying thread is actually using. */
+void
+page_copy (void *dst, const void *src) {
+	uint64_t *d = dst;
+	const uint64_t *s = src;
+	size_t i;
+
+	ASSERT (pg_ofs (dst) == 0 && pg_ofs (src) == 0);
+
+	for (i = 0; i < PGSIZE / sizeof *d; i += 4) {
+		uint64_t a = s[i], b = s[i + 1], c = s[i + 2], e = s[i + 3];
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i]) : "r" (a));
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i + 1]) : "r" (b));
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i + 2]) : "r" (c));
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i + 3]) : "r" (e));
+	}
+	__asm __volatile ("sfence" : : : "memory");
+}
+
+/* Fills the page at PAGE with zeros using non-temporal stores,
+   which bypass the cache.  Meant for pages that will not be used
+   soon, such as those the zeroing thread puts in the zero cache;
+   use memset() for a page that is about to be touched. */
+void
+page_zero (void *page) {
+	uint64_t *d = page;
+	uint64_t zero = 0;
+	size_t i;
+
+	ASSERT (pg_ofs (page) == 0);
+
+	for (i = 0; i < PGSIZE / sizeof *d; i += 4) {
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i]) : "r" (zero));
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i + 1]) : "r" (zero));
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i + 2]) : "r" (zero));
+		__asm __volatile ("movnti %1, %0" : "=m" (d[i + 3]) : "r" (zero));
+	}
+	__asm __volatile ("sfence" : : : "memory");
+}
+
+/* Takes a page from POOL's zero cache, or returns a null pointer
+   if it is empty.  Wakes the zeroing thread when the cache runs
+   low.  POOL's lock must be held. */
+static void *
+zeroed_pop (struct pool *pool) {
+	void *page;
+
+	ASSERT (lock_held_by_current_thread (&pool->lock));
+
+	if (pool->zeroed_cnt == 0)
+		return NULL;
+	page = pool->zeroed[--pool->zeroed_cnt];
+	if (zero_thread_started && pool->zeroed_cnt == ZERO_CACHE_LOW)
+		sema_up (&zero_sema);
+	return page;
+}
+
+/* Refills POOL's zero cache from its free pages. */
+static void
+zero_fill (struct pool *pool) {
+	for (;;) {
+		void *page;
+
+		lock_acquire (&pool->lock);
+		if (pool->zeroed_cnt >= ZERO_CACHE_MAX) {
+			lock_release (&pool->lock);
+			return;
+		}
+		page = pool_take (pool, 1);
+		lock_release (&pool->lock);
+		if (page == NULL)
+			return;
+
+		// lock 밖에서 0으로 채운다
+		page_zero (page);
+
+		lock_acquire (&pool->lock);
+		if (pool->zeroed_cnt < ZERO_CACHE_MAX) {
+			pool->zeroed[pool->zeroed_cnt++] = page;
+			page = NULL;
+		}
+		lock_release (&pool->lock);
+		if (page != NULL)
+			palloc_free_page (page);
+	}
+}
+
+/* Keeps the zero caches of both pools filled off the allocation
+   path, sleeping until a cache falls to ZERO_CACHE_LOW. */
+static void
+zero_thread (void *aux UNUSED) {
+	for (;;) {
+		zero_fill (&kernel_pool);
+		zero_fill (&user_pool);
+		sema_down (&zero_sema);
+	}
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -335,18 +570,231 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_bytes = ROUND_UP (bitmap_buf_size (pgcnt), sizeof (uint64_t));
+	size_t bm_pages = DIV_ROUND_UP (bm_bytes
+			+ pgcnt * sizeof (struct buddy_page), PGSIZE) * PGSIZE;
+	size_t i;
 
 	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->zeroed_cnt = 0;
+	p->free_cnt = p->low_free = p->fail_cnt = 0;
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_bytes);
 	p->base = (void *) start;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
+	// buddy: 아직 free block은 없다
+	ASSERT (pgcnt < BUDDY_NIL);
+	p->pages = (struct buddy_page *) ((uint8_t *) *bm_base + bm_bytes);
+	p->page_cnt = pgcnt;
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = -1;
+	for (i = 0; i < BUDDY_ORDERS; i++) {
+		p->free_head[i] = BUDDY_NIL;
+		p->free_blocks[i] = 0;
+	}
+
 	*bm_base += bm_pages;
 }
 
+/* Adds the block of ORDER at page IDX to POOL's free lists. */
+static void
+buddy_push (struct pool *pool, size_t idx, int order) {
+	struct buddy_page *bp = &pool->pages[idx];
+	uint32_t head = pool->free_head[order];
+
+	bp->order = order;
+	bp->prev = BUDDY_NIL;
+	bp->next = head;
+	if (head != BUDDY_NIL)
+		pool->pages[head].prev = idx;
+	pool->free_head[order] = idx;
+	pool->free_blocks[order]++;
+}
+
+/* Removes the free block at page IDX from POOL's free lists. */
+static void
+buddy_remove (struct pool *pool, size_t idx) {
+	struct buddy_page *bp = &pool->pages[idx];
+	int order = bp->order;
+
+	ASSERT (order >= 0);
+	if (bp->prev != BUDDY_NIL)
+		pool->pages[bp->prev].next = bp->next;
+	else
+		pool->free_head[order] = bp->next;
+	if (bp->next != BUDDY_NIL)
+		pool->pages[bp->next].prev = bp->prev;
+	bp->order = -1;
+	pool->free_blocks[order]--;
+}
+
+/* Frees the block of ORDER at page IDX, merging it with its
+   buddy as long as the buddy is a free block of the same order. */
+static void
+buddy_free_block (struct pool *pool, size_t idx, int order) {
+	while (order < BUDDY_ORDERS - 1) {
+		size_t buddy = idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > pool->page_cnt
+				|| pool->pages[buddy].order != order)
+			break;
+		buddy_remove (pool, buddy);
+		if (buddy < idx)
+			idx = buddy;
+		order++;
+	}
+	buddy_push (pool, idx, order);
+}
+
+/* Frees PAGE_CNT pages starting at page IDX as the largest
+   aligned blocks that fit. */
+static void
+buddy_free_range (struct pool *pool, size_t idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < BUDDY_ORDERS - 1
+				&& (idx & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free_block (pool, idx, order);
+		idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL and returns the page
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  Pages past PAGE_CNT in the block are freed again. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	int order = 0, o;
+	size_t idx;
+
+	while (order < BUDDY_ORDERS && ((size_t) 1 << order) < page_cnt)
+		order++;
+	for (o = order; o < BUDDY_ORDERS; o++)
+		if (pool->free_head[o] != BUDDY_NIL)
+			break;
+	if (o >= BUDDY_ORDERS)
+		return BITMAP_ERROR;
+
+	idx = pool->free_head[o];
+	buddy_remove (pool, idx);
+	while (o > order) {
+		o--;
+		buddy_push (pool, idx + ((size_t) 1 << o), o);
+	}
+	if (page_cnt < ((size_t) 1 << order))
+		buddy_free_range (pool, idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return idx;
+}
+
+/* Takes the PAGE_CNT free pages starting at page IDX out of
+   POOL's free lists.  Each free block that overlaps the range is
+   removed and its pages outside the range are freed again. */
+static void
+buddy_claim (struct pool *pool, size_t idx, size_t page_cnt) {
+	size_t end = idx + page_cnt;
+
+	while (idx < end) {
+		size_t head = idx, block_end;
+		int order;
+
+		/* Find the free block that contains page IDX. */
+		for (order = 0; order < BUDDY_ORDERS; order++) {
+			head = idx & ~(((size_t) 1 << order) - 1);
+			if (pool->pages[head].order == order)
+				break;
+		}
+		ASSERT (order < BUDDY_ORDERS);
+
+		buddy_remove (pool, head);
+		block_end = head + ((size_t) 1 << order);
+		buddy_free_range (pool, head, idx - head);
+		if (block_end > end) {
+			buddy_free_range (pool, end, block_end - end);
+			block_end = end;
+		}
+		idx = block_end;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   first, or a null pointer if none are available.  A request
+   that is not a power of two needs an aligned block of the next
+   one up from buddy_alloc(), so if there is none, any free run of
+   PAGE_CNT pages is looked for in the bitmap, as before the buddy
+   allocator.  POOL's lock must be held, except during
+   initialization. */
+static void *
+pool_take (struct pool *pool, size_t page_cnt) {
+	size_t page_idx = buddy_alloc (pool, page_cnt);
+
+	if (page_idx == BITMAP_ERROR && page_cnt > 1
+			&& pool->free_cnt >= page_cnt) {
+		page_idx = bitmap_scan (pool->used_map, 0, page_cnt, false);
+		if (page_idx != BITMAP_ERROR)
+			buddy_claim (pool, page_idx, page_cnt);
+	}
+	if (page_idx == BITMAP_ERROR)
+		return NULL;
+	ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	pool->free_cnt -= page_cnt;
+	if (pool->free_cnt < pool->low_free)
+		pool->low_free = pool->free_cnt;
+	return pool->base + PGSIZE * page_idx;
+}
+
+/* Returns PAGE_CNT pages starting at page PAGE_IDX to POOL.
+   POOL's lock must be held, except during initialization. */
+static void
+pool_release (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free_range (pool, page_idx, page_cnt);
+	pool->free_cnt += page_cnt;
+}
+
+/* Returns the length of the longest run of free pages in POOL.
+   Neighbouring free blocks that are not buddies still add up.
+   POOL's lock must be held. */
+static size_t
+largest_free_run (struct pool *pool) {
+	size_t idx = 0, run = 0, best = 0;
+
+	while (idx < pool->page_cnt) {
+		int order = pool->pages[idx].order;
+
+		if (order >= 0) {
+			run += (size_t) 1 << order;
+			idx += (size_t) 1 << order;
+			if (run > best)
+				best = run;
+		} else {
+			run = 0;
+			idx++;
+		}
+	}
+	return best;
+}
+
+/* Prints statistics for POOL, called NAME. */
+static void
+pool_print_stats (struct pool *pool, const char *name) {
+	size_t largest;
+
+	lock_acquire (&pool->lock);
+	largest = largest_free_run (pool);
+	printf ("Palloc %s pool: %zu of %zu pages free (%zu zeroed), "
+			"low %zu, largest run %zu, %zu failures\n",
+			name, pool->free_cnt, pool->page_cnt, pool->zeroed_cnt,
+			pool->low_free, largest, pool->fail_cnt);
+	lock_release (&pool->lock);
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
@@ -0,0 +1,177 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   A slab cache hands out objects of one type.  Each slab is a
+   page from the kernel pool with a header at its start followed
+   by as many objects as fit, each padded to the cache's
+   alignment.  Unlike malloc(), nothing is rounded up to a power
+   of two, so a 90-byte object costs 96 bytes rather than 128,
+   and objects of one type sit together in memory.
+
+   Objects that were never handed out are bump-allocated from the
+   end of the used part of the slab; freed objects go on a
+   per-slab free list threaded through their first bytes.  A slab
+   whose objects are all free is kept for reuse, up to
+   SLAB_EMPTY_MAX per cache, and otherwise returned to palloc. */
+
+/* Empty slabs a cache keeps instead of freeing. */
+#define SLAB_EMPTY_MAX 1
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab, at the start of its page. */
+struct slab {
+	unsigned magic;             /* Always SLAB_MAGIC. */
+	struct slab_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* In one of the cache's lists. */
+	size_t used;                /* Objects handed out. */
+	size_t bumped;              /* Objects ever handed out. */
+	void *free;                 /* Free object list. */
+};
+
+static struct slab *obj_to_slab (struct slab_cache *, void *obj);
+
+/* Initializes cache C for objects of SIZE bytes aligned to ALIGN,
+   a power of two.  If INIT is non-null it is called on every
+   object slab_alloc() returns, every time, since a free object's
+   first bytes hold the free list.  NAME is used in statistics. */
+void
+slab_cache_init (struct slab_cache *c, const char *name,
+		size_t size, size_t align, slab_init_func *init) {
+	ASSERT (align != 0 && (align & (align - 1)) == 0);
+
+	if (size < sizeof (void *))
+		size = sizeof (void *);
+	if (align < sizeof (void *))
+		align = sizeof (void *);
+
+	c->name = name;
+	c->obj_size = size;
+	c->stride = ROUND_UP (size, align);
+	c->offset = ROUND_UP (sizeof (struct slab), align);
+	ASSERT (c->offset + c->stride <= PGSIZE);
+	c->objs_per_slab = (PGSIZE - c->offset) / c->stride;
+	c->init = init;
+
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	c->slab_cnt = 0;
+	c->obj_cnt = 0;
+}
+
+/* Allocates an object from cache C.  Returns a null pointer if
+   memory is not available. */
+void *
+slab_alloc (struct slab_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else {
+		if (!list_empty (&c->empty)) {
+			s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+			c->empty_cnt--;
+		} else {
+			s = palloc_get_page (0);
+			if (s == NULL) {
+				lock_release (&c->lock);
+				return NULL;
+			}
+			s->magic = SLAB_MAGIC;
+			s->cache = c;
+			s->used = s->bumped = 0;
+			s->free = NULL;
+			c->slab_cnt++;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	if (s->free != NULL) {
+		obj = s->free;
+		s->free = *(void **) obj;
+	} else {
+		ASSERT (s->bumped < c->objs_per_slab);
+		obj = (uint8_t *) s + c->offset + s->bumped++ * c->stride;
+	}
+	if (++s->used == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_back (&c->full, &s->elem);
+	}
+	c->obj_cnt++;
+	lock_release (&c->lock);
+
+	if (c->init != NULL)
+		c->init (obj);
+	return obj;
+}
+
+/* Returns OBJ, which must have come from slab_alloc(C), to C.
+   Does nothing if OBJ is null. */
+void
+slab_free (struct slab_cache *c, void *obj) {
+	struct slab *s;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs. */
+	memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	*(void **) obj = s->free;
+	s->free = obj;
+	if (s->used-- == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->used == 0) {
+		list_remove (&s->elem);
+		if (c->empty_cnt < SLAB_EMPTY_MAX) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else {
+			s->magic = 0;
+			palloc_free_page (s);
+			c->slab_cnt--;
+		}
+	}
+	c->obj_cnt--;
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for cache C. */
+void
+slab_print_stats (struct slab_cache *c) {
+	printf ("Slab %s: %zu objects of %zu bytes in use, %zu slabs of %zu\n",
+			c->name, c->obj_cnt, c->stride, c->slab_cnt, c->objs_per_slab);
+}
+
+/* Returns the slab containing OBJ, checking that it belongs to
+   cache C and is properly placed. */
+static struct slab *
+obj_to_slab (struct slab_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT (pg_ofs (obj) >= c->offset);
+	ASSERT ((pg_ofs (obj) - c->offset) % c->stride == 0);
+	return s;
+}
@@ -110,9 +110,10 @@ sema_up (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	if (!list_empty (&sema->waiters)){
-		list_sort(&sema->waiters, cmp_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
+		// donation으로 순서가 바뀌었을 수 있으니 정렬 대신 최댓값을 찾는다
+		struct list_elem *e = list_min (&sema->waiters, cmp_priority, NULL);
+		list_remove (e);
+		thread_unblock (list_entry (e, struct thread, elem));
 	}
 
 	sema->value++;
@@ -178,6 +179,100 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->max_priority = PRI_MIN;
+
+	lock->adaptive = false;
+	lock->acquire_cnt = 0;
+	lock->contended_cnt = 0;
+	lock->spin_cnt = 0;
+}
+
+/* Initializes LOCK as an adaptive lock.  An adaptive lock is
+   meant for short critical sections: a thread that finds it held
+   first spins while the holder is running on another CPU, or
+   yields to a ready holder of equal or higher priority, and only
+   blocks on the semaphore when neither helps. */
+void
+lock_init_adaptive (struct lock *lock) {
+	lock_init (lock);
+	lock->adaptive = true;
+}
+
+/* Max number of spin or yield rounds before an adaptive lock
+   falls back to blocking. */
+#define LOCK_SPIN_MAX 64
+
+static void lock_take (struct lock *);
+
+/* Takes LOCK and makes the current thread its holder if it is
+   free, as one step with interrupts off, so that no thread can
+   see LOCK taken but without a holder to donate to.
+   Returns true if LOCK was taken. */
+static bool
+lock_try_take (struct lock *lock) {
+	enum intr_level old_level = intr_disable ();
+	bool success = sema_try_down (&lock->semaphore);
+
+	if (success)
+		lock_take (lock);
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Tries to take adaptive LOCK without sleeping, waiting on the
+   holder while it is likely to release LOCK soon.
+   Returns true if LOCK was taken, with the current thread as its
+   holder. */
+static bool
+lock_spin (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	int i;
+
+	for (i = 0; i < LOCK_SPIN_MAX; i++) {
+		struct thread *holder = lock->holder;
+
+		if (lock_try_take (lock))
+			return true;
+		if (holder == NULL)
+			break;
+
+		if (holder->status == THREAD_RUNNING)
+			asm volatile ("pause" : : : "memory");	// 다른 CPU에서 실행 중
+		else if (holder->status == THREAD_READY
+				&& holder->priority >= curr->priority)
+			thread_yield ();						// holder가 먼저 끝내도록 양보
+		else
+			break;									// holder가 block됨, 기다려도 소용 없음
+	}
+	return false;
+}
+
+/* Max depth of a nested donation chain. */
+#define DONATE_DEPTH_MAX 8
+
+/* Returns the highest priority among the threads waiting on
+   SEMA, or PRI_MIN if there are none. */
+static int
+waiters_max_priority (struct semaphore *sema) {
+	if (list_empty (&sema->waiters))
+		return PRI_MIN;
+	// cmp_priority는 내림차순 비교라서 list_min이 최댓값
+	return list_entry (list_min (&sema->waiters, cmp_priority, NULL),
+			struct thread, elem)->priority;
+}
+
+/* Makes the current thread the holder of LOCK, which it has just
+   taken.  Must be called with interrupts off. */
+static void
+lock_take (struct lock *lock) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = curr;
+	curr->wait_on_lock = NULL;	// holder가 되었기 때문에 wait_on_lock을 비워준다.
+	lock->max_priority = waiters_max_priority (&lock->semaphore);
+	list_push_back (&curr->held_locks, &lock->elem);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -191,63 +286,81 @@ lock_init (struct lock *lock) {
 void
 lock_acquire (struct lock *lock) {
 	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	// non available
-	if(!thread_mlfqs){
-		if((&lock->semaphore)->value <= 0){
-			// store address of the lock
-			curr->wait_on_lock = lock;
+	lock->acquire_cnt++;
+	if (lock->holder != NULL) {
+		lock->contended_cnt++;
+		if (lock->adaptive && lock_spin (lock)) {
+			lock->spin_cnt++;
+			return;
+		}
+	}
 
-			// maintain donated threads
-			list_insert_ordered(&lock->holder->donors, &curr->d_elem, cmp_d_priority, NULL);
+	old_level = intr_disable ();
 
-			// Store current priority
-			donate_priority(lock);
-		}
+	// non available
+	if (!thread_mlfqs && lock->holder != NULL) {
+		// store address of the lock
+		curr->wait_on_lock = lock;
+		donate_priority (lock, curr->priority);
 	}
 
 	sema_down (&lock->semaphore);		// blocking
-	lock->holder = thread_current();
-	lock->holder->wait_on_lock = NULL;	// holder가 되었기 때문에 wait_on_lock을 비워준다.
+	lock_take (lock);
+
+	intr_set_level (old_level);
 }
 
+static void donate_thread (struct thread *, int priority, int depth);
 
-// 우선순위 비교 함수
-bool
-cmp_d_priority(const struct list_elem *curr_elem, const struct list_elem *e, void *aux UNUSED){
-	struct thread *curr_thread = list_entry(curr_elem, struct thread, d_elem);
-	struct thread *next_thread = list_entry(e, struct thread, d_elem);
-	if (curr_thread->priority > next_thread->priority)
-		return true;
-	else 
-		return false;
+/* Records that a thread waits on LOCK with PRIORITY, and donates
+   it to LOCK's holder.  DEPTH is the length of the chain so far. */
+static void
+donate_lock (struct lock *lock, int priority, int depth) {
+	if (lock->max_priority < priority)
+		lock->max_priority = priority;
+	if (lock->holder != NULL)
+		donate_thread (lock->holder, priority, depth);
 }
 
-void
-donate_priority(struct lock *lock){
-	struct thread *holder_thread;
-	struct thread *first_donor;
-
-	if(!list_empty(&lock->holder->donors)){
-		list_sort(&lock->holder->donors, cmp_d_priority, NULL);	// 우선순위가 바뀌었을 수도 있기 때문에 재정렬
-
-		holder_thread = lock->holder;
-		first_donor = list_entry(list_begin(&lock->holder->donors), struct thread, d_elem);
-		if (holder_thread->priority < first_donor->priority){
-			holder_thread->priority = first_donor->priority;	// donate
-
-			// nested donation
-			if (holder_thread->wait_on_lock != NULL){
-				donate_priority(holder_thread->wait_on_lock);
-			}
-		}
+/* Raises T's priority to PRIORITY and passes it on to whatever T
+   waits for: the holder of its lock, or, if T is a writer waiting
+   for readers to drain, each of those readers. */
+static void
+donate_thread (struct thread *t, int priority, int depth) {
+	if (t->priority >= priority || depth >= DONATE_DEPTH_MAX)
+		return;
+
+	t->priority = priority;	// donate
+	if (t->wait_on_lock != NULL)
+		donate_lock (t->wait_on_lock, priority, depth + 1);	// nested donation
+	else if (t->wait_on_rwlock != NULL) {
+		struct list *readers = &t->wait_on_rwlock->readers;
+		struct list_elem *e;
+
+		for (e = list_begin (readers); e != list_end (readers); e = list_next (e))
+			donate_thread (list_entry (e, struct rwlock_hold, elem)->reader,
+					priority, depth + 1);
 	}
 }
 
+/* Donates PRIORITY to the holder of LOCK and, if that holder is
+   itself waiting on a lock, along the chain of holders.  A writer
+   waiting on an rwlock passes it on to the rwlock's readers.
+   Each lock remembers the highest priority among its waiters, so
+   no donor list has to be kept sorted; the walk stops as soon as
+   a holder already runs at PRIORITY or higher. */
+void
+donate_priority (struct lock *lock, int priority) {
+	if (lock != NULL)
+		donate_lock (lock, priority, 0);
+}
+
 /* Tries to acquires LOCK and returns true if successful or false
    on failure.  The lock must not already be held by the current
    thread.
@@ -256,15 +369,10 @@ donate_priority(struct lock *lock){
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
-	bool success;
-
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
-	return success;
+	return lock_try_take (lock);
 }
 
 /* Releases LOCK, which must be owned by the current thread.
@@ -275,41 +383,46 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 void
 lock_release (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if(!thread_mlfqs){
-		// remove
-		remove_lock(lock);
-		// holder_priority refresh
-		refresh_lock(lock);
-	}
-
+	old_level = intr_disable ();
+	list_remove (&lock->elem);
 	lock->holder = NULL;
+
+	// holder_priority refresh
+	if (!thread_mlfqs)
+		refresh_priority (curr);
+
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
-// lock의 다음 holder를 donors에서 삭제하는 함수
+/* Recomputes T's priority as the largest of its own priority,
+   the highest priority waiting on any lock T still holds, and the
+   priority of any writer waiting on an rwlock T holds for
+   reading. */
 void
-remove_lock(struct lock *lock){
+refresh_priority (struct thread *t) {
 	struct list_elem *e;
+	int i;
 
-	if(!list_empty(&lock->holder->donors)){
-		for(e=list_begin(&lock->holder->donors); e!=list_end(&lock->holder->donors); e=list_next(e)){
-			if(list_entry(e, struct thread, d_elem)->wait_on_lock == lock){
-				list_remove(e);
-			}
-		}
+	t->priority = t->original_priority;
+	for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+			e = list_next (e)) {
+		struct lock *held = list_entry (e, struct lock, elem);
+		if (held->max_priority > t->priority)
+			t->priority = held->max_priority;
+	}
+	for (i = 0; i < RWLOCK_HOLDS_MAX; i++) {
+		struct rwlock *rw = t->read_holds[i].rw;
+		if (rw != NULL && rw->writer != NULL
+				&& rw->writer->priority > t->priority)
+			t->priority = rw->writer->priority;
 	}
-}
-
-// 원래 holder의 priority를 refresh하는 함수
-void
-refresh_lock(struct lock *lock){
-	if(!list_empty(&lock->holder->donors))
-		lock->holder->priority = list_entry(list_max(&lock->holder->donors, cmp_d_priority, NULL), struct thread, d_elem)->priority;
-	else
-		lock->holder->priority = lock->holder->original_priority;
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -321,7 +434,150 @@ lock_held_by_current_thread (const struct lock *lock) {
 
 	return lock->holder == thread_current ();
 }
+
+/* Prints contention statistics for LOCK, labelled NAME. */
+void
+lock_print_stats (const struct lock *lock, const char *name) {
+	ASSERT (lock != NULL);
+
+	printf ("Lock %s: %lld acquires, %lld contended, %lld without blocking\n",
+			name, lock->acquire_cnt, lock->contended_cnt, lock->spin_cnt);
+}
 
+/* Initializes reader-writer lock RW.
+
+   Writers hold RW->lock for the whole critical section, while
+   readers take it only long enough to register themselves.  A
+   writer that arrives while readers are active keeps holding
+   RW->lock and waits for them to drain, so readers that arrive
+   later queue up behind it.  Since both sides wait on an ordinary
+   lock, a waiting reader donates its priority to the writer
+   through the usual wait_on_lock chain.  A draining writer
+   donates its priority to the active readers, found through RW's
+   list of read holds, and a priority donated to the writer later
+   is passed on to them the same way.  refresh_priority() counts
+   a waiting writer's priority for each of its readers, so they
+   keep it until they leave. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->lock);
+	sema_init (&rw->drain, 0);
+	rw->reader_cnt = 0;
+	rw->writer = NULL;
+	list_init (&rw->readers);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  A thread may hold at most
+   RWLOCK_HOLDS_MAX rwlocks for reading at once. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rwlock_hold *hold = NULL;
+	enum intr_level old_level;
+	int i;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	for (i = 0; i < RWLOCK_HOLDS_MAX; i++)
+		if (curr->read_holds[i].rw == NULL) {
+			hold = &curr->read_holds[i];
+			break;
+		}
+	ASSERT (hold != NULL);	// read hold가 RWLOCK_HOLDS_MAX개를 넘으면 안 된다
+
+	lock_acquire (&rw->lock);		// writer가 있으면 여기서 대기하면서 donate
+
+	old_level = intr_disable ();
+	rw->reader_cnt++;
+	hold->rw = rw;
+	list_push_back (&rw->readers, &hold->elem);
+	intr_set_level (old_level);
+
+	lock_release (&rw->lock);
+}
+
+/* Releases read access to RW held by the current thread. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rwlock_hold *hold = NULL;
+	enum intr_level old_level;
+	int i;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (rw->reader_cnt > 0);
+	for (i = 0; i < RWLOCK_HOLDS_MAX; i++)
+		if (curr->read_holds[i].rw == rw) {
+			hold = &curr->read_holds[i];
+			break;
+		}
+	ASSERT (hold != NULL);
+	list_remove (&hold->elem);
+	hold->rw = NULL;
+
+	// writer에게 받은 priority 반납
+	if (!thread_mlfqs && rw->writer != NULL)
+		refresh_priority (curr);
+
+	if (--rw->reader_cnt == 0 && rw->writer != NULL)
+		sema_up (&rw->drain);
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it in either mode. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->lock);
+
+	old_level = intr_disable ();
+	while (rw->reader_cnt > 0) {
+		rw->writer = curr;
+		curr->wait_on_rwlock = rw;
+
+		// 대기 중인 writer의 priority를 active reader들에게 donate
+		if (!thread_mlfqs)
+			for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+					e = list_next (e))
+				donate_thread (list_entry (e, struct rwlock_hold, elem)->reader,
+						curr->priority, 0);
+		sema_down (&rw->drain);
+	}
+	rw->writer = NULL;
+	curr->wait_on_rwlock = NULL;
+	intr_set_level (old_level);
+}
+
+/* Releases write access to RW held by the current thread. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_for_write (rw));
+
+	lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return lock_held_by_current_thread (&rw->lock);
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem {
 	struct list_elem elem;              /* List element. */
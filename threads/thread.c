@@ -5,9 +5,11 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
@@ -43,13 +45,30 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Reaper thread, which frees the pages of dead threads off the
+   scheduler's path. */
+static struct thread *reaper_thread;
+static bool reaper_idle;        /* Blocked waiting for destruction_req? */
+
+/* Recycled thread pages and fd tables.  thread_create() takes from
+   these before going to the page allocator, so fork/exec-heavy
+   loads skip two page allocations per thread.  A recycled page is
+   not zeroed: init_thread() clears `struct thread' and the kernel
+   stack needs no clearing.  Accessed with interrupts off. */
+#define THREAD_CACHE_MAX 8
+static void *thread_page_cache[THREAD_CACHE_MAX];
+static size_t thread_page_cache_cnt;
+#ifdef USERPROG
+static struct file **fd_table_cache[THREAD_CACHE_MAX];
+static size_t fd_table_cache_cnt;
+#endif
+
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
@@ -57,14 +76,45 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use stride scheduling.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+/* Pass of the most recently scheduled thread.  A thread that
+   becomes ready starts no earlier than this, so that time spent
+   blocked does not turn into a burst of CPU later. */
+static int64_t global_pass;
+
+/* If true, print per-thread scheduler accounting and the context
+   switch trace.  Controlled by kernel command-line option
+   "-sched-trace". */
+bool thread_sched_trace;
+
+/* Context switch trace, a ring of the most recent switches. */
+#define SWITCH_TRACE_SIZE 256   /* Must be a power of 2. */
+struct switch_record {
+	uint64_t tsc;                   /* TSC at the switch. */
+	tid_t prev;                     /* Thread switched away from. */
+	tid_t next;                     /* Thread switched to. */
+	enum thread_status prev_status; /* PREV's new status. */
+};
+static struct switch_record switch_trace[SWITCH_TRACE_SIZE];
+static unsigned long long switch_cnt;   /* # of context switches. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void reaper (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
+static bool yield_needed (struct thread *);
+static void yield_to_higher (bool preempted);
+static list_less_func *ready_less (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -129,6 +179,7 @@ thread_init (void) {
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
+	initial_thread->last_tsc = rdtsc ();
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -139,6 +190,7 @@ thread_start (void) {
 	struct semaphore idle_started;
 	sema_init (&idle_started, 0);
 	thread_create ("idle", PRI_MIN, idle, &idle_started);
+	thread_create ("reaper", PRI_MIN, reaper, NULL);
 
 	/* Start preemptive thread scheduling. */
 	intr_enable ();
@@ -163,9 +215,15 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
+	/* Charge the tick against the thread's share. */
+	if (thread_stride && t != idle_thread)
+		t->pass += t->stride;
+
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (++thread_ticks >= (unsigned) t->time_slice) {
+		t->preempted = true;
 		intr_yield_on_return ();
+	}
 }
 
 /* Prints thread statistics. */
@@ -173,6 +231,41 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+
+	if (thread_sched_trace) {
+		struct list_elem *e;
+
+		for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e))
+			thread_print_sched_stats (list_entry (e, struct thread, all_elem));
+		thread_dump_switch_trace ();
+	}
+}
+
+/* Prints T's scheduler accounting.  Times are in TSC cycles. */
+void
+thread_print_sched_stats (const struct thread *t) {
+	printf ("Thread %d (%s): run %llu, ready %llu, "
+			"%u voluntary/%u involuntary switches, "
+			"wakeup latency avg %llu max %llu\n",
+			t->tid, t->name, t->run_tsc, t->ready_tsc,
+			t->voluntary_cnt, t->involuntary_cnt,
+			t->wakeup_cnt ? t->wakeup_tsc / t->wakeup_cnt : 0,
+			t->max_wakeup_tsc);
+}
+
+/* Prints the most recent context switches, oldest first. */
+void
+thread_dump_switch_trace (void) {
+	static const char *status_names[] = {"running", "ready", "blocked", "dying"};
+	unsigned long long i;
+
+	i = switch_cnt > SWITCH_TRACE_SIZE ? switch_cnt - SWITCH_TRACE_SIZE : 0;
+	printf ("Context switch trace (%llu switches):\n", switch_cnt);
+	for (; i < switch_cnt; i++) {
+		const struct switch_record *r = &switch_trace[i & (SWITCH_TRACE_SIZE - 1)];
+		printf ("  %llu: %d -> %d (%s)\n",
+				r->tsc, r->prev, r->next, status_names[r->prev_status]);
+	}
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -199,15 +292,27 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_get ();
 	if (t == NULL)
 		return TID_ERROR;
 
+#ifdef USERPROG
+	// intialize fd_table
+	struct file **fd_table = fd_table_alloc ();
+	if (fd_table == NULL){
+		thread_page_put (t);
+		return TID_ERROR;
+	}
+#endif
+
 	/* Initialize thread. */
 	init_thread (t, name, priority);
+#ifdef USERPROG
+	t->fd_table = fd_table;
+#endif
 
 	// 부모 자식 설정
-	if (strcmp(t->name, "idle")){
+	if (function != idle && function != reaper){
 		t->parent_thread = thread_current();
 		list_push_back(&t->parent_thread->child_list, &t->c_elem);
 	}
@@ -225,17 +330,6 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-#ifdef USERPROG
-	// intialize fd_table
-	t->fd_table = (struct file **)palloc_get_page(PAL_ZERO);
-	if (t->fd_table == NULL){
-		palloc_free_page(t);
-		return TID_ERROR;
-	}
-	for (int i = 3; i < OPEN_MAX; i++){
-		t->fd_table[i] = NULL;
-	}
-#endif
 #ifdef VM
 	supplemental_page_table_init (&t->spt);
 #endif
@@ -247,6 +341,76 @@ thread_create (const char *name, int priority,
 	return tid;
 }
 
+/* Returns a page for a new thread, recycled if possible, or a
+   null pointer if none is available.  The page is not zeroed. */
+static struct thread *
+thread_page_get (void) {
+	void *page = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (thread_page_cache_cnt > 0)
+		page = thread_page_cache[--thread_page_cache_cnt];
+	else if (!list_empty (&destruction_req))
+		/* A dead thread the reaper has not gotten to yet.  It is
+		   not running, so its page is free to reuse. */
+		page = list_entry (list_pop_front (&destruction_req), struct thread, elem);
+	intr_set_level (old_level);
+
+	return page != NULL ? page : palloc_get_page (0);
+}
+
+/* Recycles the page of dead thread T, or frees it if the cache
+   is full. */
+static void
+thread_page_put (struct thread *t) {
+	enum intr_level old_level = intr_disable ();
+
+	if (thread_page_cache_cnt < THREAD_CACHE_MAX) {
+		t->magic = 0;	// 재사용 전에 is_thread()에 걸리지 않도록
+		thread_page_cache[thread_page_cache_cnt++] = t;
+	} else
+		palloc_free_page (t);
+	intr_set_level (old_level);
+}
+
+#ifdef USERPROG
+/* Returns an fd table with every entry null, recycled if possible,
+   or a null pointer if none is available.  Only the OPEN_MAX
+   entries in use are cleared. */
+struct file **
+fd_table_alloc (void) {
+	struct file **fd_table = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (fd_table_cache_cnt > 0)
+		fd_table = fd_table_cache[--fd_table_cache_cnt];
+	intr_set_level (old_level);
+
+	if (fd_table == NULL)
+		fd_table = palloc_get_page (0);
+	if (fd_table != NULL)
+		memset (fd_table, 0, OPEN_MAX * sizeof *fd_table);
+	return fd_table;
+}
+
+/* Recycles FD_TABLE, or frees it if the cache is full. */
+void
+fd_table_free (struct file **fd_table) {
+	enum intr_level old_level;
+
+	if (fd_table == NULL)
+		return;
+
+	old_level = intr_disable ();
+
+	if (fd_table_cache_cnt < THREAD_CACHE_MAX)
+		fd_table_cache[fd_table_cache_cnt++] = fd_table;
+	else
+		palloc_free_page (fd_table);
+	intr_set_level (old_level);
+}
+#endif
+
 /* Puts the current thread to sleep.  It will not be scheduled
    again until awoken by thread_unblock().
 
@@ -277,8 +441,12 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);	// 우선순위 고려
+	if (thread_stride && t->pass < global_pass)
+		t->pass = global_pass;
+	list_insert_ordered(&ready_list, &t->elem, ready_less (), NULL);	// 우선순위 고려
 	t->status = THREAD_READY;
+	t->last_tsc = rdtsc ();											// wakeup 시점 기록
+	t->woken = true;
 	intr_set_level (old_level);
 }
 
@@ -293,13 +461,41 @@ cmp_priority(const struct list_elem *curr_elem, const struct list_elem *e, void
 		return false;
 }
 
+// pass 비교 함수
+bool
+cmp_pass(const struct list_elem *curr_elem, const struct list_elem *e, void *aux UNUSED){
+	struct thread *curr_thread = list_entry(curr_elem, struct thread, elem);
+	struct thread *next_thread = list_entry(e, struct thread, elem);
+	return curr_thread->pass < next_thread->pass;
+}
+
+/* Returns the ordering of ready_list for the scheduling class in
+   use: by pass under stride scheduling, by priority otherwise. */
+static list_less_func *
+ready_less (void) {
+	return thread_stride ? cmp_pass : cmp_priority;
+}
+
 // 선점형 스케쥴러 구현
 void 
 thread_preempt(void){
+	yield_to_higher (true);		// 다른 쓰레드가 ready가 되어 뺏긴다
+}
+
+/* Yields the CPU if a ready thread has a higher priority than
+   the running thread.  PREEMPTED tells whether the switch is
+   forced on it, as when a higher-priority thread becomes ready,
+   or follows from its own priority change. */
+static void
+yield_to_higher (bool preempted) {
+	if (thread_stride)
+		return;		// stride는 tick마다만 교체
+
 	struct thread *curr = thread_current();		// 현재 쓰레드 선언
 	struct thread *first = list_entry(list_begin(&ready_list), struct thread, elem);
 	// 현재 쓰레드와 우선순위 비교
 	if (!intr_context() && first->priority > curr->priority){
+		curr->preempted = preempted;
 		thread_yield ();
 	}
 }
@@ -346,11 +542,36 @@ thread_exit (void) {
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
+	if (thread_sched_trace)
+		thread_print_sched_stats (thread_current ());
+	fpu_release (thread_current ());
+
 	intr_disable ();
+	list_remove (&thread_current ()->all_elem);	// 죽기 전에는 all_list에서 제거
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
 
+/* Returns true if yielding would let another thread run, that is,
+   if the front of the ready list would be scheduled ahead of or
+   alongside CURR.  Interrupts must be off. */
+static bool
+yield_needed (struct thread *curr) {
+	struct thread *front;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (list_empty (&ready_list))
+		return false;
+	if (curr == idle_thread)
+		return true;
+
+	front = list_entry (list_front (&ready_list), struct thread, elem);
+	if (thread_stride)
+		return front->pass <= curr->pass;
+	return front->priority >= curr->priority;
+}
+
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 void
@@ -361,8 +582,14 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
+	if (!yield_needed (curr)) {
+		thread_ticks = 0;		// 양보할 상대가 없으면 새 time slice로 계속 실행
+		curr->preempted = false;
+		intr_set_level (old_level);
+		return;
+	}
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, cmp_priority, NULL);	// 양보해주고 우선순위 순으로 ready에 들어간다
+		list_insert_ordered(&ready_list, &curr->elem, ready_less (), NULL);	// 양보해주고 우선순위 순으로 ready에 들어간다
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -416,18 +643,54 @@ void
 thread_set_priority (int new_priority) {
 	if(thread_mlfqs) return;	// mlfqs일 경우 모두 무시
 
-	struct lock *holding_lock;
+	enum intr_level old_level = intr_disable ();
 
-	thread_current ()->priority = new_priority;
 	thread_current ()->original_priority = new_priority;	// lock release에서 original로 복구되기 때문에 여기도 바꾼다
-	list_sort(&ready_list, cmp_priority, NULL);				// 우선순위 바꾸고 재정렬
+	refresh_priority (thread_current ());					// donation 받은 priority가 더 높으면 유지
+	list_sort(&ready_list, ready_less (), NULL);			// 우선순위 바꾸고 재정렬
 
-	// holder의 우선순위가 변경되었기 때문에 refresh
-	if (!list_empty(&thread_current()->donors)){
-		holding_lock = list_entry(list_begin(&thread_current()->donors), struct thread, d_elem)->wait_on_lock;
-		refresh_lock(holding_lock);
-	}
-	thread_preempt();										// 새로운 우선순위가 높은지 양보 확인
+	intr_set_level (old_level);
+	yield_to_higher (false);								// 새로운 우선순위가 높은지 양보 확인
+}
+
+/* Sets the current thread's time slice to TICKS timer ticks.
+   Returns false if TICKS is out of range. */
+bool
+thread_set_time_slice (int ticks) {
+	if (ticks < TIME_SLICE_MIN || ticks > TIME_SLICE_MAX)
+		return false;
+
+	thread_current ()->time_slice = ticks;
+	return true;
+}
+
+/* Returns the current thread's time slice in timer ticks. */
+int
+thread_get_time_slice (void) {
+	return thread_current ()->time_slice;
+}
+
+/* Sets the current thread's stride scheduling tickets to TICKETS.
+   Returns false if TICKETS is out of range. */
+bool
+thread_set_tickets (int tickets) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	if (tickets < TICKETS_MIN || tickets > TICKETS_MAX)
+		return false;
+
+	old_level = intr_disable ();
+	curr->tickets = tickets;
+	curr->stride = STRIDE1 / tickets;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Returns the current thread's stride scheduling tickets. */
+int
+thread_get_tickets (void) {
+	return thread_current ()->tickets;
 }
 
 /* Returns the current thread's priority. */
@@ -471,8 +734,8 @@ thread_set_nice (int new_nice) {
 	
 	thread_current ()->nice = new_nice;
 	update_priority();
-	list_sort(&ready_list, cmp_priority, NULL);
-	thread_preempt();
+	list_sort(&ready_list, ready_less (), NULL);
+	yield_to_higher (false);
 
 	intr_set_level(old_level);
 }
@@ -592,6 +855,58 @@ idle (void *idle_started_ UNUSED) {
 	}
 }
 
+/* Reaper thread.  Frees the pages of dead threads queued on
+   destruction_req, one at a time with interrupts on, so that
+   schedule() only has to queue them.  It runs at PRI_MIN, so
+   busier threads can starve it: thread_create() takes pages
+   straight from the queue, and the page allocator calls
+   thread_reap() before it fails. */
+static void
+reaper (void *aux UNUSED) {
+	reaper_thread = thread_current ();
+
+	for (;;) {
+		struct thread *victim;
+
+		intr_disable ();
+		while (list_empty (&destruction_req)) {
+			reaper_idle = true;
+			thread_block ();
+		}
+		victim = list_entry (list_pop_front (&destruction_req), struct thread, elem);
+		intr_enable ();
+
+		thread_page_put (victim);
+	}
+}
+
+/* Frees the pages of all dead threads the reaper has not gotten
+   to yet, bypassing thread_page_cache.  Returns true if there
+   were any.  Called by the page allocator when the kernel pool
+   runs out, so must not allocate pages itself. */
+bool
+thread_reap (void) {
+	bool reaped = false;
+
+	ASSERT (!intr_context ());
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		struct thread *victim = NULL;
+
+		if (!list_empty (&destruction_req))
+			victim = list_entry (list_pop_front (&destruction_req),
+					struct thread, elem);
+		intr_set_level (old_level);
+		if (victim == NULL)
+			return reaped;
+
+		victim->magic = 0;
+		palloc_free_page (victim);
+		reaped = true;
+	}
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux) {
@@ -618,12 +933,20 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
 
-	list_init (&t->donors);						// initialize donors
+	list_init (&t->held_locks);					// initialize held_locks
 	t->wait_on_lock = NULL;						// initialize wait_on_lock
+	t->wait_on_rwlock = NULL;					// initialize wait_on_rwlock
+	for (int i = 0; i < RWLOCK_HOLDS_MAX; i++)
+		t->read_holds[i].reader = t;			// rw는 memset으로 NULL
 	t->original_priority = priority;			// set original_priority
 
 	t->nice = INITIAL_NICE;						// initialize INITIAL_NICE
 	t->recent_cpu = INITIAL_RECENT_CPU;			// intialize recent cpu
+
+	t->tickets = TICKETS_DEFAULT;				// initialize stride
+	t->stride = STRIDE1 / TICKETS_DEFAULT;
+	t->pass = global_pass;
+	t->time_slice = TIME_SLICE;
 	
 	list_push_back(&all_list, &t->all_elem);	// recent_cpu를 위한 all_list
 
@@ -662,10 +985,15 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
+	struct thread *next;
+
 	if (list_empty (&ready_list))
 		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+	next = list_entry (list_pop_front (&ready_list), struct thread, elem);
+	if (thread_stride)
+		global_pass = next->pass;
+	return next;
 }
 
 /* Use iretq to launch the thread */
@@ -708,61 +1036,22 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
+	struct thread *curr = running_thread ();
+	uint64_t next_rsp = th->switch_rsp;
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	/* The current thread is switched out from inside schedule(),
+	 * so only the callee-saved registers need to be kept; they are
+	 * pushed on its own stack and the stack pointer is stored in
+	 * curr->switch_rsp.  A thread that was switched out this way
+	 * resumes by popping them back.  A thread that has never run
+	 * has no such stack yet and is started from its intr_frame
+	 * through do_iret. */
+	if (next_rsp != 0) {
+		th->switch_rsp = 0;
+		switch_threads (&curr->switch_rsp, next_rsp);
+	} else
+		switch_to_new (&curr->switch_rsp, &th->tf);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -773,15 +1062,47 @@ static void
 do_schedule(int status) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
-		struct thread *victim =
-			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
 	thread_current ()->status = status;
 	schedule ();
 }
 
+/* Charges the time since the last switch to CURR, which is
+   giving up the CPU, and the time spent on the ready queue to
+   NEXT, and records the switch in the trace ring. */
+static void
+sched_account (struct thread *curr, struct thread *next) {
+	uint64_t now = rdtsc ();
+	struct switch_record *r;
+
+	curr->run_tsc += now - curr->last_tsc;
+	curr->last_tsc = now;
+	// 선점당했을 때만 involuntary, yield를 직접 부른 경우는 voluntary
+	if (curr->preempted)
+		curr->involuntary_cnt++;
+	else
+		curr->voluntary_cnt++;
+
+	if (next->status == THREAD_READY) {
+		uint64_t wait = now - next->last_tsc;
+
+		next->ready_tsc += wait;
+		if (next->woken) {
+			next->woken = false;
+			next->wakeup_cnt++;
+			next->wakeup_tsc += wait;
+			if (wait > next->max_wakeup_tsc)
+				next->max_wakeup_tsc = wait;
+		}
+	}
+	next->last_tsc = now;
+
+	r = &switch_trace[switch_cnt++ & (SWITCH_TRACE_SIZE - 1)];
+	r->tsc = now;
+	r->prev = curr->tid;
+	r->next = next->tid;
+	r->prev_status = curr->status;
+}
+
 static void
 schedule (void) {
 	struct thread *curr = running_thread ();
@@ -790,6 +1111,11 @@ schedule (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
+
+	if (curr != next)
+		sched_account (curr, next);
+	curr->preempted = false;
+
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
@@ -807,16 +1133,20 @@ schedule (void) {
 		   pull out the rug under itself.
 		   We just queuing the page free reqeust here because the page is
 		   currently used by the stack.
-		   The real destruction logic will be called at the beginning of the
-		   schedule(). */
+		   The real destruction is done by the reaper thread, or by
+		   thread_create() reusing the page directly. */
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
 			ASSERT (curr != next);
 			list_push_back (&destruction_req, &curr->elem);
-			list_remove(&curr->all_elem);					// 죽기 전에는 all_list에서 제거
+			if (reaper_idle) {
+				reaper_idle = false;
+				thread_unblock (reaper_thread);
+			}
 		}
 
 		/* Before switching the thread, we first save the information
 		 * of current running. */
+		fpu_switch (next);
 		thread_launch (next);
 	}
 }
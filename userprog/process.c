@@ -12,6 +12,7 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
@@ -130,7 +131,7 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	/* 4. TODO: Duplicate parent's page to the new page and
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). */
-	memcpy(newpage, parent_page, PGSIZE);
+	page_copy(newpage, parent_page);
 	writable = is_writable(pte);
 	/* 5. Add new page to child's page table at address VA with WRITABLE
 	 *    permission. */
@@ -170,6 +171,8 @@ __do_fork (void *aux) {
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
 #endif
+	if (!fpu_copy (current, parent))
+		goto error;
 
 	/* TODO: Your code goes here.
 	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
@@ -216,6 +219,7 @@ process_exec (void *f_name) {
 
 	/* We first kill the current context */
 	process_cleanup ();
+	fpu_release (thread_current ());	// 새 프로그램은 초기 FPU 상태로 시작
 
 #ifdef VM
 	supplemental_page_table_init(&thread_current()->spt);
@@ -318,7 +322,7 @@ find_exit_code(tid_t child_tid){
 		if (e_info->tid == child_tid){
 			exit_code = e_info->exit_code;
 			list_remove(e);								// 이미 죽은 자식 제거
-			free(e_info);
+			slab_free(&exit_info_cache, e_info);
 			return exit_code;
 		}
 	}
@@ -329,9 +333,13 @@ find_exit_code(tid_t child_tid){
 void 
 mmap_destroy(struct hash_elem *hash_elem, void *aux UNUSED){
 	struct page *page = hash_entry(hash_elem, struct page, hash_elem);
+	struct page *prev;
 
 	if (page && page_get_type(page) == VM_FILE){
-		_munmap(page->va);
+		// mapping의 첫 page에서만 unmap한다 (do_munmap이 끝까지 처리)
+		prev = spt_find_page(&thread_current()->spt, page->va - PGSIZE);
+		if (!prev || page_get_type(prev) != VM_FILE)
+			_munmap(page->va);
 	}
 }
 #endif
@@ -351,7 +359,7 @@ process_exit (void) {
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
 	
-	palloc_free_page((void *)curr->fd_table);	// fd_table 메모리 정리
+	fd_table_free(curr->fd_table);				// fd_table 메모리 정리 (재사용)
 
 	if (curr->file_in_use != NULL){
 		file_close(curr->file_in_use);			// 사용 중인 파일도 닫기
@@ -485,15 +493,26 @@ load (const char *file_name, struct intr_frame *if_) {
 	
 	// parse file_name
 	char *fn_copy = (char*)file_name;
-	char *argv[64];
+	char **argv, **new_argv;
 	char *ptr, *next_ptr;
 	int argc = 0;
+
+	argv = malloc(8 * sizeof *argv);
+	if (argv == NULL)
+		return false;
  
 	ptr = strtok_r(fn_copy, DELIM_CHARS, &next_ptr);
 	argv[argc] = ptr;
 	while (ptr) {
 		ptr = strtok_r(NULL, DELIM_CHARS, &next_ptr);
 		argc += 1;
+		// 가득 차면 두 배로 늘린다 (size class 안이면 realloc이 옮기지 않는다)
+		if ((argc + 1) * sizeof *argv > malloc_usable_size(argv)) {
+			new_argv = realloc(argv, 2 * (argc + 1) * sizeof *argv);
+			if (new_argv == NULL)
+				goto done;
+			argv = new_argv;
+		}
 		argv[argc] = ptr;
 	}
 
@@ -596,6 +615,7 @@ done:
 	/* We arrive here whether the load is successful or not. */
 
 	// file_close (file);
+	free(argv);
 	return success;
 }
 
@@ -646,16 +666,14 @@ validate_segment (const struct Phdr *phdr, struct file *file) {
 
 void
 load_stack(struct intr_frame *if_, char **arg_value, int arg_count){
-	char *arg_value_addr[64];
-
 	// printf("USER_STACK: %p\n", if_->rsp);
 
-	// argv[i] 쌓기
+	// argv[i] 쌓기, arg_value[i]는 user stack 주소로 바꾼다
 	for (int i=arg_count-1; i>=0; i--){
 		if_->rsp -= strlen(arg_value[i])+1;
 		memcpy((void *)if_->rsp, arg_value[i], strlen(arg_value[i])+1);
 		// printf("argv[%d][]: %p, %s\n", i, if_->rsp, arg_value[i]);
-		arg_value_addr[i] = (char *)if_->rsp;
+		arg_value[i] = (char *)if_->rsp;
 	}
 	
 	// word_align
@@ -673,7 +691,7 @@ load_stack(struct intr_frame *if_, char **arg_value, int arg_count){
 	// memcpy(if_->rsp, arg_value, sizeof(arg_value));
 	for (int i=arg_count-1; i>=0; i--){
 		if_->rsp -= sizeof(char **);
-		memcpy((void *)if_->rsp, &arg_value_addr[i], sizeof(char *));
+		memcpy((void *)if_->rsp, &arg_value[i], sizeof(char *));
 		// printf("argv[%d]: %p\n",i ,if_->rsp);
 	}
 
@@ -811,7 +829,7 @@ lazy_load_segment (struct page *page, void *aux) {
 	/* Load the segment. */
 	if (file_read (file, kva, page_read_bytes) != (int) page_read_bytes) {
 		palloc_free_page(kva);
-		free(aux_load_info);
+		slab_free(&load_info_cache, aux_load_info);
 		return false;
 	}
 	memset (kva + page_read_bytes, 0, page_zero_bytes);
@@ -848,7 +866,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
 		struct load_info *aux;
-		aux = (struct load_info *)malloc(sizeof(struct load_info));
+		aux = (struct load_info *)slab_alloc(&load_info_cache);
 
 		aux->file = file;
 		aux->ofs = ofs;
@@ -856,7 +874,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 
 		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
 					writable, lazy_load_segment, aux)){
-			free(aux);
+			slab_free(&load_info_cache, aux);
 			return false;
 		}
 
@@ -45,8 +45,11 @@ unsigned _tell (int fd);
 void _close (int fd);
 void *_mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void _munmap(void *addr);
+bool _set_tickets(int tickets);
+bool _set_time_slice(int ticks);
 
 struct lock global_sys_lock;
+struct slab_cache exit_info_cache;
 
 /* System call.
  *
@@ -74,6 +77,7 @@ syscall_init (void) {
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 	
 	lock_init(&global_sys_lock);
+	slab_cache_init(&exit_info_cache, "exit_info", sizeof(struct exit_info), sizeof(void *), NULL);
 }
 
 /* The main system call interface */
@@ -148,6 +152,14 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_MUNMAP:
 			_munmap((void *)f->R.rdi);
 			break;
+
+		case SYS_SET_TICKETS:
+			f->R.rax = _set_tickets((int)f->R.rdi);
+			break;
+
+		case SYS_SET_TIME_SLICE:
+			f->R.rax = _set_time_slice((int)f->R.rdi);
+			break;
 	}
 }
 
@@ -197,7 +209,7 @@ _exit (int status) {
 
 	// 종료 전 exit code 저장하기
 	if (curr->parent_thread != NULL){
-		exit_code_info = (struct exit_info *)malloc(sizeof(struct exit_info));
+		exit_code_info = (struct exit_info *)slab_alloc(&exit_info_cache);
 		exit_code_info->tid = curr->tid;
 		exit_code_info->exit_code = status;
 		list_push_back(&curr->parent_thread->exit_code_list, &exit_code_info->e_elem);
@@ -432,4 +444,14 @@ _munmap(void *addr){
 	#ifdef VM
 	do_munmap(addr);
 	#endif
-}
\ No newline at end of file
+}
+
+bool
+_set_tickets(int tickets){
+	return thread_set_tickets(tickets);
+}
+
+bool
+_set_time_slice(int ticks){
+	return thread_set_time_slice(ticks);
+}
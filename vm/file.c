@@ -60,15 +60,12 @@ file_backed_swap_out (struct page *page) {
 	struct thread *curr = thread_current();
 	struct load_info *aux;
 
-	// first check if the page is dirty
-	if (pml4_is_dirty(curr->pml4, page->va)){
+	// first check if the page is dirty, turning off the dirty bit
+	if (pml4_test_and_clear_dirty(curr->pml4, page->va)){
 		aux = (struct load_info *) page->uninit.aux;
 
 		// writing the contents back to the file.
 		file_write_at(aux->file, page->va, aux->page_read_bytes, aux->ofs);
-
-		// After you swap out the page, remember to turn off the dirty bit for the page.
-		pml4_set_dirty (curr->pml4, page->va, 0);
 	}
 
 	pml4_clear_page(curr->pml4, page->va);	// 페이지 테이블에서는 지워주기
@@ -101,7 +98,7 @@ do_mmap (void *addr, size_t length, int writable,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		struct load_info *aux;
-		aux = (struct load_info *)malloc(sizeof(struct load_info));
+		aux = (struct load_info *)slab_alloc(&load_info_cache);
 
 		aux->file = mapping_file;
 		aux->ofs = offset;
@@ -110,7 +107,7 @@ do_mmap (void *addr, size_t length, int writable,
 		// return NULL which is not a valid address to map a file
 		if (!vm_alloc_page_with_initializer (VM_FILE, addr,
 					writable, lazy_load_segment, aux)){
-			free(aux);
+			slab_free(&load_info_cache, aux);
 			return NULL;
 		}
 
@@ -124,31 +121,41 @@ do_mmap (void *addr, size_t length, int writable,
 	return mapped_va;
 }
 
+// munmap helper: dirty page는 파일에 다시 쓴다
+static bool
+munmap_writeback (uint64_t *pte, void *va, void *aux) {
+	struct thread *curr = aux;
+	struct page *page;
+	struct load_info *info;
+
+	if (*pte & PTE_D) {
+		page = spt_find_page(&curr->spt, va);
+		info = (struct load_info *) page->uninit.aux;
+		file_write_at(info->file, va, info->page_read_bytes, info->ofs);
+		*pte &= ~(uint64_t) PTE_D;
+	}
+	return true;
+}
+
 /* Do the munmap */
 void
 do_munmap (void *addr) {
 	// the specified address range addr
 	struct thread *curr = thread_current();
 	struct page *page;
-	struct load_info * aux;
+	void *end = addr;
 
 	// 파일이 끝날 때까지 반복
 	while (true){
 		// 파일 찾기
-		page = spt_find_page(&curr->spt, addr);
+		page = spt_find_page(&curr->spt, end);
         // 파일의 끝인지 확인
 		if (!page || page_get_type(page) != VM_FILE)
             break;
-		
-		// written back to the file
-		if (pml4_is_dirty(curr->pml4, page->va)){
-			aux = (struct load_info *) page->uninit.aux;
-			file_write_at(aux->file, addr, aux->page_read_bytes, aux->ofs);
-            pml4_set_dirty (curr->pml4, page->va, 0);
-		}
-
-		// unmap
-		pml4_clear_page(curr->pml4, page->va);
-		addr += PGSIZE;
+		end += PGSIZE;
 	}
+
+	// written back to the file, then unmap the whole range at once
+	pml4_for_each_range(curr->pml4, addr, end, munmap_writeback, curr);
+	pml4_clear_range(curr->pml4, addr, end);
 }
@@ -10,6 +10,11 @@ struct list frame_table;
 struct lock frame_table_lock;
 struct list_elem *now;
 
+/* Object caches for the VM's own bookkeeping. */
+static struct slab_cache page_cache;
+static struct slab_cache frame_cache;
+struct slab_cache load_info_cache;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -23,10 +28,22 @@ vm_init (void) {
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
     list_init(&frame_table);
-	lock_init(&frame_table_lock);
+	lock_init_adaptive(&frame_table_lock);	// 짧게 잡히는 lock
+	slab_cache_init(&page_cache, "page", sizeof(struct page), sizeof(void *), NULL);
+	slab_cache_init(&frame_cache, "frame", sizeof(struct frame), sizeof(void *), NULL);
+	slab_cache_init(&load_info_cache, "load_info", sizeof(struct load_info), sizeof(void *), NULL);
 	now = list_begin(&frame_table);
 }
 
+/* Prints virtual memory statistics. */
+void
+vm_print_stats (void) {
+	lock_print_stats (&frame_table_lock, "frame_table");
+	slab_print_stats (&page_cache);
+	slab_print_stats (&frame_cache);
+	slab_print_stats (&load_info_cache);
+}
+
 // hash helper
 static unsigned
 page_hash (const struct hash_elem *page_elem, void *aux UNUSED) {
@@ -44,12 +61,14 @@ page_less (const struct hash_elem *page_elem_a, const struct hash_elem *page_ele
 }
 
 static struct page *
-page_lookup (const void *va) {
+page_lookup (struct supplemental_page_table *spt, const void *va) {
 	struct page page;
 	struct hash_elem *page_elem;
 	
 	page.va = pg_round_down(va);
-	page_elem = hash_find(&thread_current()->spt.supplemental_page_hash, &page.hash_elem);
+	rwlock_acquire_read(&spt->spt_lock);
+	page_elem = hash_find(&spt->supplemental_page_hash, &page.hash_elem);
+	rwlock_release_read(&spt->spt_lock);
 	
 	return page_elem != NULL ? hash_entry(page_elem, struct page, hash_elem) : NULL;
 }
@@ -91,7 +110,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
 		// Create the page
-		page = (struct page *)malloc(sizeof(struct page));
+		page = (struct page *)slab_alloc(&page_cache);
 		
 		// fetch the initialier
 		switch (VM_TYPE(type)){
@@ -127,7 +146,7 @@ struct page *
 spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 	struct page *page = NULL;
 	/* TODO: Fill this function. */
-	page = page_lookup(pg_round_down(va));
+	page = page_lookup(spt, pg_round_down(va));
 	
 	if (!page) {
 		return NULL;
@@ -142,9 +161,11 @@ spt_insert_page (struct supplemental_page_table *spt UNUSED,
 		struct page *page UNUSED) {
 	int succ = false;
 	/* TODO: Fill this function. */
+	rwlock_acquire_write(&spt->spt_lock);
 	if (!hash_insert(&spt->supplemental_page_hash, &page->hash_elem)) {
 		succ = true;
 	}
+	rwlock_release_write(&spt->spt_lock);
 
 	return succ;
 }
@@ -167,9 +188,7 @@ vm_get_victim (void) {
     for (; now != list_end(&frame_table); now = list_next(now)) {
         victim = list_entry(now, struct frame, frame_elem);
 
-        if (pml4_is_accessed(curr->pml4, victim->page->va)) {
-            pml4_set_accessed(curr->pml4, victim->page->va, 0);
-        } else {
+        if (!pml4_test_and_clear_accessed(curr->pml4, victim->page->va)) {
             lock_release(&frame_table_lock);
             return victim;
         }
@@ -180,9 +199,7 @@ vm_get_victim (void) {
     for (; now != list_end(&frame_table); now = list_next(now)) {
         victim = list_entry(now, struct frame, frame_elem);
 
-        if (pml4_is_accessed(curr->pml4, victim->page->va)) {
-            pml4_set_accessed(curr->pml4, victim->page->va, 0);
-        } else {
+        if (!pml4_test_and_clear_accessed(curr->pml4, victim->page->va)) {
             lock_release(&frame_table_lock);
             return victim;
         }
@@ -212,10 +229,14 @@ vm_get_frame (void) {
 	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
     // also allocate a frame
-	frame = (struct frame *)malloc(sizeof(struct frame));
+	frame = (struct frame *)slab_alloc(&frame_cache);
+	if (frame == NULL)
+		PANIC ("vm_get_frame: out of memory for frame");
     // Gets a new physical page
 	frame->kva = palloc_get_page(PAL_USER);
 	if (!frame->kva){
+		// 새 frame 대신 evict한 frame을 재사용하므로 돌려준다
+		slab_free(&frame_cache, frame);
 		frame = vm_evict_frame();
 		frame->page = NULL;
         return frame;
@@ -292,7 +313,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	slab_free (&page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -328,6 +349,7 @@ vm_do_claim_page (struct page *page) {
 void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	hash_init(&spt->supplemental_page_hash, (hash_hash_func *)page_hash, page_less, NULL);
+	rwlock_init(&spt->spt_lock);
 }
 
 /* Copy supplemental page table from src to dst */
@@ -346,6 +368,8 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 
 	// Iterate through each page in the src's supplemental page table
 	struct hash_iterator i;
+	bool success = false;
+	rwlock_acquire_read(&src->spt_lock);
 	hash_first(&i, &src->supplemental_page_hash);
 	while (hash_next(&i))
 	{
@@ -362,24 +386,27 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 		// VM_UNINIT
 		if (parent_page->operations->type == VM_UNINIT){
 			if(!vm_alloc_page_with_initializer(type, upage, writable, init, aux))
-                return false;
+                goto done;
 		}
 		// VM_ANON or VM_FILE
 		else{
 			if (!vm_alloc_page(type, upage, writable))
-				return false;
+				goto done;
 			
 			// claim them immediately
 			if (!vm_claim_page(upage))
-				return false;
+				goto done;
 
 			// make a exact copy of the entry in the dst's supplemental page table
 			child_page = spt_find_page(dst, upage);
-			memcpy(child_page->frame->kva, parent_page->frame->kva, PGSIZE);
+			page_copy(child_page->frame->kva, parent_page->frame->kva);
 		}
 	}
+	success = true;
 
-	return true;
+done:
+	rwlock_release_read(&src->spt_lock);
+	return success;
 }
 
 // kill helper